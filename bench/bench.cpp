@@ -0,0 +1,597 @@
+// headless benchmarks for the render pipeline
+//
+// every scenario prints one json object per line:
+// {"scenario": ..., "ns_per_cell": ..., "bytes_per_frame": ...}
+//
+// usage: bench [--frames N] [--size WxH] [--filter name]
+//              [--rep] [--sync] [--colors 16|256|true]
+//              [--verify]
+//
+// --verify feeds the output to a VirtualScreen and checks it
+// against the window after every frame, --rep and --sync let
+// the encoder use REP and synchronized output, --colors sets
+// the depth colors are brought down to
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <ly/int.hpp>
+#include <ly/render/buffer.hpp>
+#include <ly/render/log_view.hpp>
+#include <ly/render/lua_bindings.hpp>
+#include <ly/render/profiler.hpp>
+#include <ly/render/sink.hpp>
+#include <ly/render/table_view.hpp>
+#include <ly/render/vscreen.hpp>
+#include <ly/render/window.hpp>
+
+#ifndef LY_BENCH_DIR
+#define LY_BENCH_DIR "bench"
+#endif
+
+using namespace ly;
+using namespace ly::render;
+
+// ----------[allocation counting]----------
+static u64 _allocs = 0;
+
+void* operator new(size_t n) {
+    _allocs++;
+    void* p = malloc(n ? n : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// ----------[scenarios]----------
+struct Context {
+    MemorySink sink;
+    Window win;
+    Profiler prof;
+    std::optional<lua::State> state;
+    std::optional<lua::LuaWidget> widget;
+    // made by the first frame of native scenarios
+    std::shared_ptr<widgets::Widget> native;
+    size_t w, h;
+
+    Context(size_t w, size_t h) : w(w), h(h) {
+        win.set_profiler(&prof);
+        win.set_sink(sink);
+        win.init_buffer(w, h);
+    }
+
+    void load(const char* script, lua::GcPolicy gc) {
+        state.emplace();
+        state->set_profiler(&prof);
+        state->set_gc(gc);
+        // a host function for the scripts to call
+        state->set_function("bench_add", [](lua_State* L) {
+            lua_pushnumber(L, luaL_checknumber(L, 1) +
+                                  luaL_checknumber(L, 2));
+            return 1;
+        });
+        std::string path = LY_BENCH_DIR "/lua/";
+        path += script;
+        widget.emplace(state->from_file(path));
+    }
+};
+
+struct Scenario {
+    const char* name;
+    const char* script;
+    // draws one frame in the back buffer
+    std::function<void(Context&, size_t)> frame;
+    // if the frame is pushed to the window
+    bool present = true;
+};
+
+static const char* _text =
+    "the quick brown fox jumps over the lazy dog ñandú ";
+
+// a process list made up on the fly, nothing is stored
+class _Processes : public widgets::RowProvider {
+    size_t _n;
+
+public:
+    _Processes(size_t n) : _n(n) {}
+
+    size_t columns() const override { return 3; }
+    size_t rows() const override { return _n; }
+
+    void header(size_t col, std::string& out) const override {
+        static const char* names[] = {"pid", "name", "cpu"};
+        out = names[col];
+    }
+
+    void cell(size_t row, size_t col,
+        std::string& out) const override {
+        u64 hash = row * 2654435761ull;
+        char tmp[32];
+        int len = 0;
+        if (col == 0)
+            len = snprintf(tmp, sizeof(tmp), "%zu", row + 1);
+        else if (col == 1)
+            len = snprintf(tmp, sizeof(tmp), "proc-%llx",
+                (unsigned long long)(hash >> (8 + hash % 16)));
+        else
+            len = snprintf(tmp, sizeof(tmp), "%.1f",
+                (hash >> 16) % 1000 / 10.);
+        out.assign(tmp, len);
+    }
+};
+
+// scrolls a few rows every frame and sorts by cpu once, the
+// time should not depend on the amount of rows
+static std::function<void(Context&, size_t)> _table_view(
+    size_t rows) {
+    return [rows](Context& c, size_t f) {
+        if (!c.native)
+            c.native = std::make_shared<widgets::TableView>(
+                std::make_shared<_Processes>(rows));
+        auto& table =
+            static_cast<widgets::TableView&>(*c.native);
+        if (f == 8)
+            table.sort_by(2, true);
+        table.scroll(3);
+        table.render(c.win.get_buf());
+    };
+}
+
+// a LogView fed per_frame lines every frame, 1700 is 100k
+// lines/s at 60 frames/s
+static std::function<void(Context&, size_t)> _log_view(
+    size_t per_frame) {
+    return [per_frame](Context& c, size_t f) {
+        if (!c.native)
+            c.native = std::make_shared<widgets::LogView>();
+        auto& log = static_cast<widgets::LogView&>(*c.native);
+
+        char line[64];
+        for (size_t i = 0; i < per_frame; ++i) {
+            int len = snprintf(line, sizeof(line),
+                "%zu.%zu GET /api/items/%zu 200", f, i,
+                (f * 31 + i) % 977);
+            log.push({line, (size_t)len},
+                i % 7 ? ConsoleColor::WHITE
+                      : ConsoleColor::YELLOW);
+        }
+        log.render(c.win.get_buf());
+    };
+}
+
+// per_frame writes spread over 8 keys, the way a thread
+// sampling something would push them
+static std::function<void(Context&, size_t)> _ingest(
+    size_t per_frame) {
+    return [per_frame](Context& c, size_t f) {
+        char key[16];
+        for (size_t i = 0; i < per_frame; ++i) {
+            snprintf(key, sizeof(key), "load%zu", i % 8);
+            c.state->push_data(key,
+                lua::Value::integer((int64_t)(f * 7 + i)));
+        }
+    };
+}
+
+// a form of the same labels every frame with a value next
+// to each one that changes, cached says if the text cache
+// is used
+static std::function<void(Context&, size_t)> _labels(
+    bool cached) {
+    return [cached](Context& c, size_t f) {
+        static const char* names[] = {"cpu usage",
+            "resident memory (MiB)", "swap", "uptime",
+            "processes running", "load average (1m)",
+            "network ↑ (KiB/s)", "network ↓ (KiB/s)"};
+        if (f == 0)
+            c.win.set_text_cache(cached);
+
+        auto& buf = c.win.get_buf();
+        // cut like the header of a narrow column
+        TextLayout label;
+        label.align    = Align::Right;
+        label.truncate = true;
+        label.ellipsis = "…";
+        label.color    = ConsoleColor::CYAN;
+        char value[16];
+        for (size_t y = 0; y < c.h; ++y) {
+            for (size_t x = 0; x + 25 <= c.w; x += 25) {
+                buf.get_sub_buffer(x, y, 16, 1)
+                    .write(names[(x / 25 + y) % 8], label);
+                int len = snprintf(value, sizeof(value),
+                    "%zu", (f + x + y) % 1000);
+                buf.get_sub_buffer(x + 17, y, 8, 1)
+                    .write({value, (size_t)len});
+            }
+        }
+    };
+}
+
+static std::vector<Scenario> _scenarios() {
+    std::vector<Scenario> s;
+
+    s.push_back({"buffer_fill", nullptr,
+        [](Context& c, size_t f) {
+            auto& buf = c.win.get_buf();
+            for (size_t y = 0; y < c.h; ++y)
+                for (size_t x = 0; x < c.w; ++x) {
+                    auto& u = buf.get(x, y);
+                    u.data  = (x + y + f) % 2 ? "#" : ".";
+                    u.fc    = ConsoleColor::GREEN;
+                }
+        },
+        false});
+
+    s.push_back({"full_repaint", nullptr,
+        [](Context& c, size_t f) {
+            auto& buf = c.win.get_buf();
+            for (size_t y = 0; y < c.h; ++y)
+                for (size_t x = 0; x < c.w; ++x) {
+                    auto& u = buf.get(x, y);
+                    u.data  = std::string(
+                        1, 'a' + (x + y + f) % 26);
+                    u.fc = (x + f) % 2 ? ConsoleColor::RED
+                                       : ConsoleColor::CYAN;
+                }
+        }});
+
+    // a static screen with 1% of the cells moving
+    s.push_back({"change_1pct", nullptr,
+        [](Context& c, size_t f) {
+            auto& buf    = c.win.get_buf();
+            size_t cells = c.w * c.h;
+            for (size_t y = 0; y < c.h; ++y)
+                for (size_t x = 0; x < c.w; ++x)
+                    buf.get(x, y).data = "-";
+
+            size_t n = cells / 100 ? cells / 100 : 1;
+            for (size_t i = 0; i < n; ++i) {
+                size_t idx = (i * 7919 + f * 104729) % cells;
+                buf.get(idx % c.w, idx / c.w).data = "*";
+            }
+        }});
+
+    // log like output, every line moves up one row
+    s.push_back({"scroll", nullptr,
+        [](Context& c, size_t f) {
+            auto& buf = c.win.get_buf();
+            for (size_t y = 0; y < c.h; ++y) {
+                auto row = buf.get_sub_buffer(0, y, c.w, 1);
+                std::string line =
+                    "line " + std::to_string(f + y) + ": ";
+                line += _text;
+                row.render_widget(line.c_str());
+            }
+        }});
+
+    // a log panel between a fixed header and status line,
+    // one new line per frame
+    s.push_back({"log_tail", nullptr,
+        [](Context& c, size_t f) {
+            auto& buf = c.win.get_buf();
+            buf.get_sub_buffer(0, 0, c.w, 1)
+                .render_widget("== log ==");
+            for (size_t y = 1; y + 1 < c.h; ++y) {
+                auto row = buf.get_sub_buffer(0, y, c.w, 1);
+                std::string line =
+                    "[" + std::to_string(f + y) + "] ";
+                line += _text;
+                row.render_widget(line.c_str());
+            }
+            std::string status =
+                "frame " + std::to_string(f % 10);
+            buf.get_sub_buffer(0, c.h - 1, c.w, 1)
+                .render_widget(status.c_str());
+        }});
+
+    // words separated by blank gaps that move, the gaps
+    // have to be erased every frame
+    s.push_back({"gaps", nullptr,
+        [](Context& c, size_t f) {
+            auto& buf = c.win.get_buf();
+            for (size_t y = 0; y < c.h; ++y) {
+                size_t x = (f + y) % 11;
+                while (x + 4 < c.w) {
+                    for (size_t i = 0; i < 4; ++i)
+                        buf.get(x + i, y).data = "word"[i];
+                    x += 4 + 5 + (x + f) % 13;
+                }
+            }
+        }});
+
+    // words with mixed attributes, like syntax highlighting
+    // or a selected row
+    s.push_back({"attributes", nullptr,
+        [](Context& c, size_t f) {
+            static const u8 styles[] = {0, attr::BOLD,
+                attr::UNDERLINE, attr::BOLD | attr::ITALIC,
+                attr::DIM, attr::REVERSE, attr::STRIKE};
+            auto& buf = c.win.get_buf();
+            for (size_t y = 0; y < c.h; ++y) {
+                bool selected = y == f % c.h;
+                for (size_t x = 0; x < c.w; ++x) {
+                    auto& u = buf.get(x, y);
+                    size_t word = (x / 6 + y + f / 8) % 7;
+                    if (x % 6 != 5)
+                        u.data = std::string(1, 'a' + word);
+                    u.attr = styles[word];
+                    if (selected)
+                        u.attr |= attr::REVERSE;
+                    u.fc = word % 2 ? ConsoleColor::GREEN
+                                    : ConsoleColor::YELLOW;
+                }
+            }
+        }});
+
+    s.push_back({"gradient", nullptr,
+        [](Context& c, size_t f) {
+            auto& buf = c.win.get_buf();
+            for (size_t y = 0; y < c.h; ++y)
+                for (size_t x = 0; x < c.w; ++x) {
+                    auto& u = buf.get(x, y);
+                    u.bc    = ConsoleColor(Color<u8>{
+                        (u8)(x * 255 / c.w + f),
+                        (u8)(y * 255 / c.h),
+                        (u8)(f * 3),
+                    });
+                }
+        }});
+
+    s.push_back({"render_widget", nullptr,
+        [](Context& c, size_t /*f*/) {
+            auto& buf = c.win.get_buf();
+            buf.render_widget(_text);
+        },
+        false});
+
+    s.push_back({"su8", nullptr,
+        [](Context& c, size_t /*f*/) {
+            size_t total = 0;
+            for (size_t y = 0; y < c.h; ++y) {
+                Su8 s = _text;
+                total += s.size();
+            }
+            if (total == 0)
+                abort();
+        },
+        false});
+
+    // only the writes, the diff would hide them
+    s.push_back({"labels", nullptr, _labels(true), false});
+    s.push_back({"labels_uncached", nullptr, _labels(false),
+        false});
+
+    s.push_back({"table_view_5k", nullptr, _table_view(5000)});
+    s.push_back(
+        {"table_view_500k", nullptr, _table_view(500000)});
+
+    s.push_back({"log_view", nullptr, _log_view(3)});
+    s.push_back(
+        {"log_view_flood", nullptr, _log_view(1700)});
+
+    s.push_back({"lua_set", "set.lua", nullptr});
+    s.push_back({"lua_get_sub", "sub.lua", nullptr});
+    s.push_back({"lua_state", "state.lua", nullptr});
+    s.push_back({"lua_host_fn", "host_fn.lua", nullptr});
+    s.push_back({"lua_ingest", "ingest.lua", _ingest(512)});
+    s.push_back({"lua_async", "async.lua", nullptr});
+    s.push_back({"lua_bars", "bars.lua", nullptr});
+    s.push_back({"native_bars", "native.lua", nullptr});
+
+    return s;
+}
+
+struct Options {
+    bool rep          = false;
+    bool sync         = false;
+    bool verify       = false;
+    ColorDepth colors = ColorDepth::TrueColor;
+    lua::GcPolicy gc;
+};
+
+// false if the output stopped matching the window
+static bool _run(const Scenario& s, size_t w, size_t h,
+    size_t frames, const Options& opt, FILE* out) {
+    using clock = std::chrono::steady_clock;
+    Context c(w, h);
+    TermCaps caps;
+    caps.rep    = opt.rep;
+    caps.sync   = opt.sync;
+    caps.colors = opt.colors;
+    c.win.encoder().set_caps(caps);
+
+    if (s.script)
+        c.load(s.script, opt.gc);
+
+    std::optional<VirtualScreen> screen;
+    if (opt.verify && s.present)
+        screen.emplace(w, h);
+    std::string mismatch;
+
+    auto frame = [&](size_t f) {
+        if (c.state) {
+            // scripts can have the frame feed their state
+            if (s.frame)
+                s.frame(c, f);
+            c.state->apply_pending();
+            c.state->dispatch_events();
+            c.state->set_data(
+                "tick", lua::Value::integer((int64_t)f));
+            c.widget->update();
+            c.win.get_buf().render_widget(*c.widget);
+        }
+        else {
+            s.frame(c, f);
+        }
+        if (s.present) {
+            c.win.render();
+            if (screen && mismatch.empty()) {
+                screen->feed(c.sink.data());
+                std::string why;
+                if (!screen->matches(
+                        c.win.front(), &why, opt.colors))
+                    mismatch = "frame " + std::to_string(f) +
+                               ": " + why;
+            }
+            c.sink.clear();
+        }
+        if (c.state) {
+            // there is no idle time here, the whole budget
+            // is given
+            Profiler::Scope _t(&c.prof, Phase::Gc);
+            c.state->collect(opt.gc.budget_us * 1000);
+        }
+    };
+
+    // warm up, the first frame is always a full repaint
+    for (size_t f = 0; f < 4; ++f) frame(f);
+
+    u64 lua_allocs = 0, lua_sys = 0, cells_changed = 0;
+    u64 lua_peak = 0, max_ns = 0;
+    u64 bytes  = c.sink.bytes_written();
+    u64 allocs = _allocs;
+    auto start = clock::now();
+    for (size_t f = 0; f < frames; ++f) {
+        c.prof.begin_frame();
+        frame(f + 4);
+        c.prof.end_frame();
+
+        const auto& st = c.prof.get(0);
+        lua_allocs += st.allocs;
+        lua_sys += st.sys_allocs;
+        lua_peak = std::max(lua_peak, st.mem_peak);
+        max_ns   = std::max(max_ns, st.busy_ns);
+        cells_changed += st.cells_changed;
+    }
+    auto elapsed = Profiler::ns(clock::now() - start);
+    allocs       = _allocs - allocs;
+    bytes        = c.sink.bytes_written() - bytes;
+
+    fprintf(out,
+        "{\"scenario\": \"%s\", \"width\": %zu, "
+        "\"height\": %zu, \"frames\": %zu, "
+        "\"ns_per_frame\": %.1f, \"max_ns\": %llu, "
+        "\"ns_per_cell\": %.3f, "
+        "\"bytes_per_frame\": %.1f, "
+        "\"cells_changed_per_frame\": %.1f, "
+        "\"allocs_per_frame\": %.2f, "
+        "\"lua_allocs_per_frame\": %.2f, "
+        "\"lua_sys_allocs_per_frame\": %.2f, "
+        "\"lua_mem_peak\": %llu}\n",
+        s.name, w, h, frames, (f64)elapsed / frames,
+        (unsigned long long)max_ns,
+        (f64)elapsed / frames / (w * h), (f64)bytes / frames,
+        (f64)cells_changed / frames, (f64)allocs / frames,
+        (f64)lua_allocs / frames, (f64)lua_sys / frames,
+        (unsigned long long)lua_peak);
+    fflush(out);
+
+    if (!mismatch.empty()) {
+        fprintf(stderr, "%s: output mismatch at %s\n", s.name,
+            mismatch.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t frames      = 200;
+    size_t w           = 200;
+    size_t h           = 50;
+    const char* filter = nullptr;
+    Options opt;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+            if (sscanf(argv[++i], "%zux%zu", &w, &h) != 2) {
+                fprintf(stderr, "bad size: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--filter") &&
+                 i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--rep")) {
+            opt.rep = true;
+        }
+        else if (!strcmp(argv[i], "--sync")) {
+            opt.sync = true;
+        }
+        else if (!strcmp(argv[i], "--colors") &&
+                 i + 1 < argc) {
+            std::string depth = argv[++i];
+            if (depth == "16")
+                opt.colors = ColorDepth::Ansi16;
+            else if (depth == "256")
+                opt.colors = ColorDepth::Indexed256;
+            else if (depth == "true")
+                opt.colors = ColorDepth::TrueColor;
+            else {
+                fprintf(stderr, "bad colors: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--gc") && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "auto")
+                opt.gc.manual = false;
+            else if (mode == "incremental")
+                opt.gc.mode = lua::GcMode::Incremental;
+            else if (mode == "generational")
+                opt.gc.mode = lua::GcMode::Generational;
+            else {
+                fprintf(stderr, "bad gc: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--gc-budget") &&
+                 i + 1 < argc) {
+            opt.gc.budget_us = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--verify")) {
+            opt.verify = true;
+        }
+        else {
+            fprintf(stderr,
+                "usage: %s [--frames N] [--size WxH] "
+                "[--filter name] [--rep] [--sync] "
+                "[--colors 16|256|true] [--verify] "
+                "[--gc auto|incremental|generational] "
+                "[--gc-budget us]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+    if (frames == 0 || w == 0 || h == 0) {
+        fprintf(stderr, "frames and size must be positive\n");
+        return 1;
+    }
+
+    bool ok = true;
+    for (const auto& s : _scenarios()) {
+        if (filter && !strstr(s.name, filter))
+            continue;
+        ok = _run(s, w, h, frames, opt, stdout) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
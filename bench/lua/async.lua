@@ -0,0 +1,29 @@
+-- an update far longer than a frame, run as a coroutine
+-- with a slice of time every frame
+local Async = widget:extend {
+    new = function(self)
+        local t = self.super.new(self)
+        setmetatable(t, self)
+        t.async = true
+        t.budget_us = 1000
+        t.runs = 0
+        t.sum = 0
+        return t
+    end,
+
+    update = function(self)
+        local sum = 0
+        for i = 1, 2000000 do
+            sum = sum + i % 7
+        end
+        self.sum = sum
+        self.runs = self.runs + 1
+    end,
+
+    render = function(self, buffer)
+        buffer:render(self.runs .. " " .. self.sum)
+    end,
+}
+Async.__index = Async
+
+return Async:new()
@@ -0,0 +1,47 @@
+-- a progress bar per row written in lua, like the Bar of
+-- init.lua
+local Bar = widget:extend {
+    new = function(self)
+        local t = self.super.new(self)
+        setmetatable(t, self)
+        t.percentage = 0.
+        return t
+    end,
+
+    render = function(self, buffer)
+        local x, _ = buffer:get_size()
+        local s = string.format("%.0f%%", self.percentage * 100)
+        buffer:get_sub(x - 7, 1, 7, 1):render(s)
+        x = x - 8
+
+        buffer:set(1, 1, '[')
+        buffer:set(x, 1, ']')
+        for i = 1, math.floor((x - 2) * self.percentage) do
+            buffer:set(i + 1, 1, '|', { type = "bit", r = 1, g = 0, b = 0 })
+        end
+    end,
+}
+Bar.__index = Bar
+
+local Bars = widget:extend {
+    new = function(self)
+        local t = self.super.new(self)
+        setmetatable(t, self)
+        t.bar = Bar:new()
+        return t
+    end,
+
+    update = function(self) end,
+
+    render = function(self, buffer)
+        local w, h = buffer:get_size()
+        local tick = state.tick
+        for y = 1, h do
+            self.bar.percentage = ((tick + y) % 100) / 100
+            buffer:get_sub(1, y, w, 1):render(self.bar)
+        end
+    end,
+}
+Bars.__index = Bars
+
+return Bars:new()
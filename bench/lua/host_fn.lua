@@ -0,0 +1,23 @@
+-- calls a function registered from c++ in a loop, draws a
+-- single line
+local HostFn = widget:extend {
+    new = function(self)
+        local t = self.super.new(self)
+        setmetatable(t, self)
+        t.sum = 0
+        return t
+    end,
+
+    update = function(self)
+        for i = 1, 100 do
+            self.sum = state.bench_add(self.sum, i)
+        end
+    end,
+
+    render = function(self, buffer)
+        buffer:render(self.sum)
+    end,
+}
+HostFn.__index = HostFn
+
+return HostFn:new()
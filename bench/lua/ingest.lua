@@ -0,0 +1,36 @@
+-- a line per key pushed from c++, a row is only redrawn
+-- when its key changed
+local KEYS = 8
+
+local Ingest = widget:extend {
+    new = function(self)
+        local t = self.super.new(self)
+        setmetatable(t, self)
+        t.rows = {}
+        t.dirty = {}
+        for i = 1, KEYS do
+            t.rows[i] = ""
+            state.on_event("changed:load" .. (i - 1), function(v)
+                t.dirty[i] = v
+            end)
+        end
+        return t
+    end,
+
+    update = function(self)
+        for i, v in pairs(self.dirty) do
+            self.rows[i] = string.format("load%d %d", i - 1, v)
+            self.dirty[i] = nil
+        end
+    end,
+
+    render = function(self, buffer)
+        local w, _ = buffer:get_size()
+        for i = 1, KEYS do
+            buffer:get_sub(1, i, w, 1):render(self.rows[i])
+        end
+    end,
+}
+Ingest.__index = Ingest
+
+return Ingest:new()
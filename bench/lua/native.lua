@@ -0,0 +1,23 @@
+-- the same bars as bars.lua drawn by native.progress
+local Bars = widget:extend {
+    new = function(self)
+        local t = self.super.new(self)
+        setmetatable(t, self)
+        t.bar = native.progress { show_number = true }
+        return t
+    end,
+
+    update = function(self) end,
+
+    render = function(self, buffer)
+        local w, h = buffer:get_size()
+        local tick = state.tick
+        for y = 1, h do
+            self.bar.value = ((tick + y) % 100) / 100
+            buffer:get_sub(1, y, w, 1):render(self.bar)
+        end
+    end,
+}
+Bars.__index = Bars
+
+return Bars:new()
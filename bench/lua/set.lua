@@ -0,0 +1,26 @@
+-- fills every cell with buf:set
+local Set = widget:extend {
+    new = function(self)
+        local t = self.super.new(self)
+        setmetatable(t, self)
+        return t
+    end,
+
+    update = function(self) end,
+
+    render = function(self, buffer)
+        local w, h = buffer:get_size()
+        local tick = state.tick
+        local color = { type = "8bit", r = 0, g = 0, b = 0 }
+        for y = 1, h do
+            for x = 1, w do
+                color.r = (x + tick) % 256
+                color.g = (y * 4) % 256
+                buffer:set(x, y, string.char(97 + (x + y + tick) % 26), color)
+            end
+        end
+    end,
+}
+Set.__index = Set
+
+return Set:new()
@@ -0,0 +1,23 @@
+-- reads and writes state fields, draws a single line
+local State = widget:extend {
+    new = function(self)
+        local t = self.super.new(self)
+        setmetatable(t, self)
+        t.sum = 0
+        return t
+    end,
+
+    update = function(self)
+        for _ = 1, 100 do
+            self.sum = self.sum + state.tick
+        end
+        state.bench_sum = self.sum
+    end,
+
+    render = function(self, buffer)
+        buffer:render(state.bench_sum)
+    end,
+}
+State.__index = State
+
+return State:new()
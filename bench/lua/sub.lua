@@ -0,0 +1,21 @@
+-- one sub buffer and one string render per row
+local Sub = widget:extend {
+    new = function(self)
+        local t = self.super.new(self)
+        setmetatable(t, self)
+        return t
+    end,
+
+    update = function(self) end,
+
+    render = function(self, buffer)
+        local w, h = buffer:get_size()
+        local tick = state.tick
+        for y = 1, h do
+            buffer:get_sub(1, y, w, 1):render('row ' .. y .. ' tick ' .. tick)
+        end
+    end,
+}
+Sub.__index = Sub
+
+return Sub:new()
@@ -1,6 +1,7 @@
 #ifndef __LY_EXCEPTIONS__
 #define __LY_EXCEPTIONS__
 
+#include <sstream>
 #include <stdexcept>
 
 namespace ly {
@@ -4,9 +4,12 @@
 #include <ly/int.hpp>
 
 #include <concepts>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <string>
+#include <string_view>
 #include <vector>
 
 // std::ostream shenanigans
@@ -24,9 +27,18 @@ struct Color {
     T r = {}, g = {}, b = {};
 };
 
+// how many colors the terminal can show, colors above it are
+// brought down to the nearest one when encoded
+enum class ColorDepth : u8 {
+    // the 16 ansi colors
+    Ansi16,
+    Indexed256,
+    TrueColor,
+};
+
 struct ConsoleColor {
 private:
-    enum { Bit, TrueColor } _ty;
+    enum { Bit, TrueColor, Indexed256 } _ty;
     union _ColorUnion {
         enum class _BitCol : int32_t {
             BLACK  = 0b000,
@@ -39,9 +51,11 @@ private:
             WHITE  = 0b111,
         } bit_col;
         Color<u8> true_col;
+        u8 index;
 
         _ColorUnion(_BitCol col) { this->bit_col = col; }
         _ColorUnion(Color<u8> col) { this->true_col = col; }
+        _ColorUnion(u8 idx) { this->index = idx; }
     } dt;
 
     ConsoleColor(ConsoleColor::_ColorUnion::_BitCol col)
@@ -54,9 +68,24 @@ public:
     ConsoleColor(int col)
         : _ty(Bit), dt((_ColorUnion::_BitCol)col) {};
 
+    // a color of the xterm 256 palette, 0-15 are the ansi
+    // colors, 16-231 a 6x6x6 cube and the rest grays
+    static ConsoleColor indexed(u8 index);
+
     bool operator==(const ConsoleColor& other) const;
-    void display_fc();
-    void display_bc();
+    // kind in the high byte and the color in the rest, used
+    // to store colors in files
+    u32 pack() const;
+    static ConsoleColor unpack(u32 packed);
+    // the closest color the depth can show, indexed colors
+    // below 8 become bit colors so equal colors compare equal
+    ConsoleColor downsample(ColorDepth depth) const;
+    // append the escape sequence to out
+    void display_fc(std::string& out) const;
+    void display_bc(std::string& out) const;
+    // only the SGR parameters, to combine several in one
+    // sequence
+    void sgr_params(std::string& out, bool fg) const;
 
     static const ConsoleColor WHITE;
     static const ConsoleColor BLACK;
@@ -68,15 +97,88 @@ public:
     static const ConsoleColor BLUE;
 };
 
-// char_t is a string bc I don't want to bother to
-// conver it to utf8 when rendering in a console
-using char_t = std::string;
+// one utf8 character kept inline, so cells are plain memory
+// that can be copied and cleared without allocating. The
+// unused bytes are zero, so two glyphs compare as a block.
+// Sequences longer than CAPACITY are cut at the last
+// character that fits
+class Glyph {
+public:
+    static constexpr size_t CAPACITY = 15;
+
+private:
+    char _bytes[CAPACITY] = {' '};
+    u8 _len               = 1;
+
+public:
+    Glyph() = default;
+    Glyph(char c) { this->assign(&c, 1); }
+    Glyph(const char* s) { this->assign(s, std::strlen(s)); }
+    Glyph(std::string_view s) {
+        this->assign(s.data(), s.size());
+    }
+    Glyph(const std::string& s) {
+        this->assign(s.data(), s.size());
+    }
+
+    void assign(const char* s, size_t len) {
+        // cut where a character starts, continuation bytes
+        // are 10xxxxxx
+        if (len > CAPACITY) {
+            len = CAPACITY;
+            while (len > 0 && ((u8)s[len] >> 6) == 0b10)
+                len--;
+        }
+        std::memcpy(this->_bytes, s, len);
+        std::memset(this->_bytes + len, 0, CAPACITY - len);
+        this->_len = len;
+    }
+
+    const char* data() const { return this->_bytes; }
+    size_t size() const { return this->_len; }
+    std::string_view view() const {
+        return {this->_bytes, this->_len};
+    }
+    operator std::string_view() const { return this->view(); }
+
+    bool operator==(const Glyph& other) const {
+        return std::memcmp(this, &other, sizeof(Glyph)) == 0;
+    }
+    bool operator==(std::string_view s) const {
+        return this->view() == s;
+    }
+    bool operator==(const char* s) const {
+        return this->view() == s;
+    }
+    bool operator==(const std::string& s) const {
+        return this->view() == s;
+    }
+};
+
+std::ostream& operator<<(std::ostream& os, const Glyph& g);
+
+using char_t = Glyph;
+
+// text attributes, a Unit holds them or'd together
+namespace attr {
+constexpr u8 BOLD      = 1 << 0;
+constexpr u8 DIM       = 1 << 1;
+constexpr u8 ITALIC    = 1 << 2;
+constexpr u8 UNDERLINE = 1 << 3;
+constexpr u8 REVERSE   = 1 << 4;
+constexpr u8 STRIKE    = 1 << 5;
+// the ones that show on a space
+constexpr u8 VISIBLE = UNDERLINE | REVERSE | STRIKE;
+} // namespace attr
 
 struct Unit {
     char_t data = " ";
     ConsoleColor fc;
     ConsoleColor bc;
+    u8 attr = 0;
     Unit();
+
+    bool operator==(const Unit& other) const;
 };
 
 void render(Buffer& buf);
@@ -96,9 +198,9 @@ concept Renderable =
 // utf8 representation of a string
 class Su8 {
 public:
-    using iterator = std::vector<char_t>::iterator;
+    using iterator = std::vector<std::string>::iterator;
     using const_iterator =
-        std::vector<char_t>::const_iterator;
+        std::vector<std::string>::const_iterator;
 
 private:
     std::vector<std::string> _cs;
@@ -121,10 +223,49 @@ public:
 
 std::ostream& operator<<(std::ostream& other, const Su8& s);
 
+enum class Align : u8 {
+    Left,
+    Center,
+    Right,
+};
+
+// how Buffer::write places text
+struct TextLayout {
+    // of the last row, the ones before it are full
+    Align align = Align::Left;
+    // keep to the first row instead of wrapping
+    bool truncate = false;
+    // replaces the end of text that doesn't fit
+    std::string_view ellipsis = {};
+    ConsoleColor color        = ConsoleColor::WHITE;
+};
+
+// cells the text takes, one per utf8 glyph
+size_t glyph_count(std::string_view text);
+// bytes of the glyph text starts with, text can't be empty
+size_t glyph_len(std::string_view text);
+
+// the glyphs Buffer::write leaves in an area, laid out once
+// to be put in any buffer of the same size
+struct TextRun {
+    std::vector<Glyph> glyphs;
+    // of the area, the rows taken and the cells the last
+    // row is moved right by the alignment
+    size_t width = 0, rows = 0, pad = 0;
+};
+
+class TextCache;
+
 class Buffer {
 private:
-    using _Buffer =
-        std::shared_ptr<std::vector<std::vector<Unit>>>;
+    // the cells row by row, shared with the sub buffers
+    struct _Storage {
+        std::vector<Unit> cells;
+        size_t width = 0, height = 0;
+        // used by write when set
+        TextCache* text = nullptr;
+    };
+    using _Buffer = std::shared_ptr<_Storage>;
     _Buffer _data;
     size_t _x, _y;
     size_t _w, _h;
@@ -155,6 +296,47 @@ public:
     const size_t width() const;
     const size_t height() const;
 
+    // changes the size in place, the cells that stay keep
+    // their content and the new ones get fg and bg. Rows
+    // are cut or padded, not reflowed, the widgets draw the
+    // whole window again at the new size anyway. The cells
+    // are one row-major vector that keeps its capacity, so
+    // shrinking and growing back doesn't allocate. Sub
+    // buffers of it keep the old size
+    void resize(size_t w, size_t h,
+        ConsoleColor fg = ConsoleColor::WHITE,
+        ConsoleColor bg = ConsoleColor::BLACK);
+
+    // moves rows top to bottom (inclusive) up by n, down if
+    // n is negative. The rows left behind keep stale cells
+    void shift_rows(size_t top, size_t bottom, long n);
+
+    // every cell becomes a blank with fg and bg
+    void clear(ConsoleColor fg = ConsoleColor::WHITE,
+        ConsoleColor bg = ConsoleColor::BLACK);
+    // exchanges the contents, sub buffers follow the storage
+    void swap(Buffer& other);
+
+    // copies the utf8 glyphs of text into the cells row by
+    // row. returns the amount of cells written
+    size_t write(
+        std::string_view text, const TextLayout& layout = {});
+    // what write puts in the cells, for the size of this
+    // buffer
+    void layout(std::string_view text,
+        const TextLayout& layout, TextRun& out) const;
+    // copies a run laid out for this size, returns the
+    // cells written
+    size_t put(const TextRun& run, ConsoleColor color);
+
+    // write looks text up in the cache before laying it
+    // out. It is kept with the cells, so sub buffers use it
+    // too
+    void set_text_cache(TextCache* cache) {
+        _data->text = cache;
+    }
+    TextCache* text_cache() const { return _data->text; }
+
     template <typename T>
         requires Renderable<T>
     void render_widget(const T& widget) {
@@ -166,19 +348,7 @@ public:
     void render_widget(const T& widget) {
         std::ostringstream ss;
         ss << widget;
-        Su8 s      = ss.str().c_str();
-        size_t idx = 0;
-        for (const auto& c : s) {
-            size_t i = idx % this->_w;
-            size_t j = idx / this->_w;
-            if (j >= this->_h) {
-                break;
-            }
-
-            this->get(i, j).data = c;
-            this->get(i, j).fc   = ConsoleColor::WHITE;
-            idx++;
-        }
+        this->write(ss.view());
     }
 };
 
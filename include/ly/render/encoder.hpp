@@ -0,0 +1,98 @@
+#ifndef __RENDER_ENCODER_HPP__
+#define __RENDER_ENCODER_HPP__
+
+#include <ly/int.hpp>
+#include <ly/render/buffer.hpp>
+#include <ly/render/sink.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ly::render {
+
+// a horizontal run of changed cells
+struct Run {
+    size_t x, y, len;
+};
+
+// rows top to bottom (inclusive) moved up by n, or down
+// when n is negative. The n rows it exposes are repainted
+struct Scroll {
+    size_t top, bottom;
+    long n;
+};
+
+// what the terminal understands besides plain cursor
+// movement and colors
+struct TermCaps {
+    // erase characters (ECH) and erase line (EL)
+    bool erase = true;
+    // scroll region (DECSTBM) and scroll up/down (SU/SD)
+    bool scroll = true;
+    // repeat the last glyph (REP)
+    bool rep = false;
+    // synchronized output (DEC mode 2026), the terminal
+    // shows each frame at once
+    bool sync = false;
+    ColorDepth colors = ColorDepth::TrueColor;
+};
+
+// guessed from TERM and COLORTERM
+TermCaps detect_caps();
+// asks the terminal with DECRQM if it knows mode 2026, the
+// answer is read from the input of the sink so it has to be
+// in raw mode. Bytes read that aren't part of the answer
+// are appended to rest
+bool query_sync_output(TerminalSink& sink,
+    std::string& rest, int timeout_ms = 200);
+
+// turns the damage of a frame into escape sequences, for
+// every run it picks the cheapest way to get the cursor
+// there and to fill it
+class Encoder {
+public:
+    static constexpr size_t UNKNOWN = SIZE_MAX;
+
+private:
+    TermCaps _caps;
+
+    // where the terminal has the cursor
+    size_t _cx = UNKNOWN, _cy = UNKNOWN;
+    // colors and attributes the terminal is using, the
+    // colors already downsampled
+    std::optional<ConsoleColor> _fc, _bc;
+    std::optional<u8> _attr;
+    // scratch for building SGR parameters
+    std::string _delta, _reset;
+
+    void _move(const Buffer& screen, size_t x, size_t y,
+        std::string& out);
+    void _pen(const Unit& u, bool blank, std::string& out);
+    void _scroll(const Buffer& screen, const Scroll& scroll,
+        std::string& out);
+    size_t _reprint_cost(const Buffer& screen, size_t from,
+        size_t to, size_t y, size_t limit) const;
+
+public:
+    Encoder(TermCaps caps = {}) : _caps(caps) {}
+
+    void set_caps(TermCaps caps) { _caps = caps; }
+    const TermCaps& caps() const { return _caps; }
+
+    // forget the state of the terminal, for when something
+    // else wrote to it
+    void invalidate();
+
+    // screen holds what the terminal should show once out
+    // is written, only the cells in damage are sent. nothing
+    // is appended when there is nothing to send. scroll is
+    // done before the damage is painted
+    void encode(const Buffer& screen,
+        const std::vector<Run>& damage, std::string& out,
+        const Scroll* scroll = nullptr);
+};
+
+} // namespace ly::render
+
+#endif
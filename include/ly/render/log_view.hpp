@@ -0,0 +1,95 @@
+#ifndef __RENDER_LOG_VIEW_HPP__
+#define __RENDER_LOG_VIEW_HPP__
+
+#include <ly/int.hpp>
+#include <ly/render/mpsc.hpp>
+#include <ly/render/widgets.hpp>
+
+#include <atomic>
+#include <string_view>
+#include <vector>
+
+namespace ly::render::widgets {
+
+// the tail of a log, fed from any thread.
+//
+// push copies the line into a slot of a lock-free queue and
+// never blocks, when the queue is full the line is dropped
+// and counted. The render thread takes what was queued,
+// splits it into glyphs once and keeps the last lines in a
+// ring of glyphs, so nothing is allocated per line after
+// the widget is made.
+//
+// lines wrap to the width, the newest one is at the bottom
+// once the view is full, so following the tail moves rows
+// up and the window can scroll them with the terminal
+class LogView : public Widget {
+public:
+    // longer lines are cut
+    static constexpr size_t LINE_BYTES = 256;
+
+    struct Config {
+        // lines kept and the glyphs shared by them
+        size_t lines  = 4096;
+        size_t glyphs = 4096 * 64;
+        // lines that can wait for the render thread
+        size_t queue = 4096;
+    };
+
+private:
+    struct Pending {
+        u32 color;
+        u32 len;
+        char bytes[LINE_BYTES];
+    };
+
+    struct Line {
+        // in the glyph ring, counted from the first glyph
+        // ever stored
+        u64 start;
+        u32 len;
+        u32 color;
+    };
+
+    mutable MpscQueue<Pending> _queue;
+    std::atomic<u64> _dropped = 0;
+
+    // filled while rendering, render is const
+    mutable std::vector<Glyph> _glyphs;
+    mutable std::vector<Line> _lines;
+    // lines ever stored and the first one still kept
+    mutable u64 _first = 0, _next = 0;
+    mutable u64 _glyph_end = 0;
+    // lines back from the newest, 0 follows the tail
+    mutable u64 _offset = 0;
+
+    void _store(const Pending& p) const;
+    size_t _height(const Line& line, size_t w) const;
+
+public:
+    LogView();
+    LogView(Config config);
+
+    // any thread, splits text at newlines. false if a line
+    // was dropped
+    bool push(std::string_view text,
+        ConsoleColor color = ConsoleColor::WHITE);
+    u64 dropped() const { return _dropped; }
+
+    // moves what was pushed into the lines, render does it
+    // too. The render thread
+    size_t take() const;
+    size_t size() const { return _next - _first; }
+
+    // by lines, positive goes back. The view stays where it
+    // is when new lines come until it is back at the tail
+    void scroll(i64 delta);
+    void follow() { _offset = 0; }
+    bool following() const { return _offset == 0; }
+
+    void render(Buffer& buffer) const override;
+};
+
+} // namespace ly::render::widgets
+
+#endif
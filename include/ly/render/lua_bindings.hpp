@@ -2,14 +2,23 @@
 #define __RENDER_LUA_BINDINGS_HPP__
 
 #include <functional>
+#include <ly/int.hpp>
+#include <ly/render/lua_cache.hpp>
+#include <ly/render/lua_class.hpp>
+#include <ly/render/lua_pool.hpp>
+#include <ly/render/mpsc.hpp>
+#include <ly/render/profiler.hpp>
 #include <ly/render/widgets.hpp>
 
 #include <lua.hpp>
 
+#include <atomic>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace ly::render::lua {
 
@@ -120,9 +129,108 @@ Value Value::array(Args&&... args) {
     return Value(ArrayType{std::forward<Args>(args)...});
 }
 
+void push_value(lua_State* L, const Value& val);
+Value to_value(lua_State* L, int index);
+
+// the native widgets as userdata, made by the functions of
+// the global table `native`
+void open_native_widgets(lua_State* L);
+// null when the value at index is not a native widget
+widgets::Widget* to_native_widget(lua_State* L, int index);
+
+using EventId = u32;
+
+// event names are interned once, after that everything is
+// done with the id so posting an event never touches a
+// string
+class EventBus {
+public:
+    static constexpr EventId INVALID = ~EventId(0);
+    // payloads up to this size are stored inline
+    static constexpr size_t SMALL_PAYLOAD = 15;
+
+private:
+    struct _Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    struct _Entry {
+        std::vector<int> handlers = {};
+        bool coalesce             = false;
+        // index in the queue of the pending event, used
+        // for coalescing
+        size_t pending = SIZE_MAX;
+    };
+
+    struct _Queued {
+        EventId id;
+        u8 small_len = 0;
+        char small[SMALL_PAYLOAD];
+        Value payload = Value::none();
+    };
+
+    std::unordered_map<std::string, EventId, _Hash,
+        std::equal_to<>>
+        _ids;
+    std::vector<std::string> _names;
+    std::vector<_Entry> _entries;
+
+    std::vector<_Queued> _queue;
+    std::vector<_Queued> _dispatching;
+    // the event and the handler of it being called
+    size_t _cursor = 0, _handler = 0;
+
+    _Queued& _enqueue(EventId id);
+    static int _dispatch_batch(lua_State* L);
+
+public:
+    EventId intern(std::string_view name);
+    EventId find(std::string_view name) const;
+    const std::string& name(EventId id) const;
+
+    // coalescing events only keep the last payload posted
+    // in a frame
+    void set_coalesce(EventId id, bool coalesce);
+
+    // takes the function at idx
+    void subscribe(lua_State* L, EventId id, int idx);
+    // removes the function at idx, true if it was found
+    bool unsubscribe(lua_State* L, EventId id, int idx);
+    bool has_handlers(EventId id) const;
+
+    void post(EventId id, std::string_view payload);
+    void post(EventId id, Value payload);
+    size_t pending() const { return _queue.size(); }
+
+    // delivers everything queued so far inside a single
+    // protected call, returns the amount of events
+    size_t dispatch(lua_State* L);
+};
+
 class State;
 class LuaWidget;
 
+enum class GcMode : u8 {
+    Incremental,
+    Generational,
+};
+
+struct GcPolicy {
+    GcMode mode = GcMode::Incremental;
+    // lua never collects on its own, State::collect does it
+    // between frames. when false lua keeps its own pacing
+    bool manual = true;
+    // longest a call to collect can take
+    u64 budget_us = 2000;
+    // how much lua can grow over what was alive after the
+    // last collection before starting another one, in
+    // percent. 0 picks 100 (incremental) or 20 (generational)
+    u32 growth = 0;
+};
+
 class State {
 public:
     using Fn = std::function<int(lua_State*)>;
@@ -136,16 +244,107 @@ private:
     };
 
     Value _data = Value::map();
+    // has to outlive _L
+    Pool _pool;
     std::shared_ptr<lua_State> _L;
     std::unordered_map<std::string, Fn> _funcs;
 
+    EventBus _events;
+    EventId _ev_keypress;
+
+    Profiler* _prof = nullptr;
+    ChunkCache _cache;
+
+    GcPolicy _gc;
+    // memory alive after the last collection
+    size_t _gc_live = 0;
+    // an incremental cycle was started and is not done
+    bool _gc_cycle = false;
+    // lua's own collector was turned back on, memory went
+    // too far over the limit
+    bool _gc_auto = false;
+
+    // a write or an event posted from another thread
+    struct Ingest {
+        bool event = false;
+        std::string key;
+        Value value = Value::none();
+    };
+    MpscQueue<Ingest> _inbox{INBOX};
+    std::atomic<u64> _inbox_dropped = 0;
+    // watched keys written by the batch being applied, each
+    // once, and the name of the event of a key
+    std::vector<std::pair<EventId, const Value*>> _changed;
+    std::string _changed_name;
+
+    // the update being resumed and when it has to yield
+    lua_State* _running = nullptr;
+    Profiler::clock::time_point _deadline;
+
+    static void* _alloc(
+        void* ud, void* ptr, size_t osize, size_t nsize);
+    static int _panic(lua_State* L);
+    static void _budget_hook(lua_State* L, lua_Debug* ar);
+
 public:
+    // updates that can wait for apply_pending
+    static constexpr size_t INBOX = 4096;
+    // time an async update gets per frame, unless the
+    // widget has budget_us
+    static constexpr u64 UPDATE_BUDGET_US = 2000;
+    // instructions run between checks of the budget
+    static constexpr int HOOK_COUNT = 1000;
+
     State();
 
+    // the State that owns L
+    static State* from_lua(lua_State* L);
+
+    void set_profiler(Profiler* prof) { _prof = prof; }
+    Profiler* profiler() { return _prof; }
+    const Pool::Stats& memory() const { return _pool.stats(); }
+
+    // compiled scripts, used by from_file and require
+    ChunkCache& cache() { return _cache; }
+
+    void set_gc(GcPolicy policy);
+    const GcPolicy& gc() const { return _gc; }
+    // runs the collector for at most idle_ns (or the budget
+    // of the policy) when enough garbage piled up. with no
+    // time left the step is sized by how far memory is over
+    // the limit, and past twice the limit lua collects on
+    // its own until it is back under. true when a
+    // collection finished
+    bool collect(u64 idle_ns);
+    // a call from c++ into lua
+    void count_lua_call(size_t n = 1) {
+        if (_prof)
+            _prof->current().lua_calls += n;
+    }
+
     void press(char key);
+    void post(std::string_view event, Value payload);
+    size_t dispatch_events();
+    EventBus& events() { return _events; }
     bool should_exit();
 
+    // resumes co until it returns or yields, it is made to
+    // yield when budget_ns are gone. What it returns or
+    // yields is dropped, returns the status of lua_resume
+    int resume(lua_State* co, int nargs, u64 budget_ns);
+
     void set_data(std::string key, Value val);
+    // any thread. queue a write of a key or an event for
+    // apply_pending, false (and counted) when the queue is
+    // full and the update was dropped
+    bool push_data(std::string_view key, Value val);
+    bool push_event(std::string_view event, Value payload);
+    u64 dropped_updates() const { return _inbox_dropped; }
+    // the frame loop, once before dispatching the events.
+    // applies what was pushed since the last call in one
+    // batch. a key written many times posts "changed:<key>"
+    // once with the last value, returns the updates taken
+    size_t apply_pending();
     void set_function(std::string key, Fn fn);
     const Value& get_data(std::string key) const;
     bool func_exitst(std::string key);
@@ -163,6 +362,10 @@ private:
     std::weak_ptr<lua_State> _L;
     std::unordered_map<std::string, int> _events = {};
     int _ref;
+    // the coroutine of an async update still running
+    int _co = LUA_NOREF;
+
+    void _update_async(lua_State* L);
 
 protected:
     // takes the table in the stack
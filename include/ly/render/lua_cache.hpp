@@ -0,0 +1,59 @@
+#ifndef __RENDER_LUA_CACHE_HPP__
+#define __RENDER_LUA_CACHE_HPP__
+
+#include <ly/int.hpp>
+
+#include <lua.hpp>
+
+#include <string>
+
+namespace ly::render::lua {
+
+namespace cache {
+constexpr const char* MAGIC = "LYBC";
+constexpr u32 VERSION       = 1;
+} // namespace cache
+
+// compiled chunks kept on disk so scripts are only parsed
+// when they change. one file per script, named after the
+// hash of its path:
+//
+//   header:   "LYBC" u32 version, u64 mtime_ns, u64 size,
+//             u64 hash (fnv-1a of the source)
+//   bytecode: what lua_dump wrote
+//
+// a script with the same mtime and size is loaded without
+// reading it, one that was only touched is matched by the
+// hash. Files are replaced with a rename so a crash never
+// leaves half of one
+class ChunkCache {
+    std::string _dir;
+    u64 _hits = 0, _misses = 0;
+
+    std::string _file_for(const std::string& path) const;
+    void _store(const std::string& file,
+        const std::string& data);
+
+public:
+    // $XDG_CACHE_HOME/lui or ~/.cache/lui, empty when
+    // neither is set
+    static std::string default_dir();
+
+    ChunkCache(std::string dir = default_dir())
+        : _dir(std::move(dir)) {}
+
+    // an empty dir turns the cache off
+    void set_dir(std::string dir) { _dir = std::move(dir); }
+    const std::string& dir() const { return _dir; }
+
+    // same as luaL_loadfile: pushes the chunk, or the error
+    // message when it returns something other than LUA_OK
+    int load(lua_State* L, const std::string& path);
+
+    u64 hits() const { return _hits; }
+    u64 misses() const { return _misses; }
+};
+
+} // namespace ly::render::lua
+
+#endif
@@ -0,0 +1,516 @@
+#ifndef __RENDER_LUA_CLASS_HPP__
+#define __RENDER_LUA_CLASS_HPP__
+
+#include <ly/int.hpp>
+#include <ly/render/buffer.hpp>
+
+#include <lua.hpp>
+
+#include <concepts>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ly::render::lua {
+
+// colors as {type = "bit" | "8bit", r, g, b} or
+// {type = "256", index}, false when index is not one
+bool to_color(lua_State* L, int index, ConsoleColor& out);
+void push_color(lua_State* L, ConsoleColor color);
+
+// ----------[conversions]----------
+// how a c++ type goes in and out of the lua stack. is()
+// never raises an error nor allocates, so every argument
+// can be checked before anything is built and an error
+// (a longjmp) never skips a destructor
+template <typename T>
+struct Convert;
+
+template <typename C>
+void _expect(lua_State* L, int idx) {
+    if (!C::is(L, idx))
+        luaL_typeerror(L, idx, C::name);
+}
+
+// the value at idx as a T, a type error otherwise
+template <typename T>
+T check(lua_State* L, int idx) {
+    _expect<Convert<T>>(L, idx);
+    return Convert<T>::to(L, idx);
+}
+
+template <typename T>
+void push(lua_State* L, const T& val) {
+    Convert<T>::push(L, val);
+}
+
+template <>
+struct Convert<bool> {
+    static constexpr const char* name = "boolean";
+    static bool is(lua_State*, int) { return true; }
+    static bool to(lua_State* L, int idx) {
+        return lua_toboolean(L, idx);
+    }
+    static void push(lua_State* L, bool val) {
+        lua_pushboolean(L, val);
+    }
+};
+
+template <typename T>
+    requires(std::integral<T> && !std::same_as<T, bool>)
+struct Convert<T> {
+    static constexpr const char* name = "integer";
+    static bool is(lua_State* L, int idx) {
+        int ok;
+        lua_tointegerx(L, idx, &ok);
+        return ok;
+    }
+    static T to(lua_State* L, int idx) {
+        return (T)lua_tointeger(L, idx);
+    }
+    static void push(lua_State* L, T val) {
+        lua_pushinteger(L, (lua_Integer)val);
+    }
+};
+
+template <std::floating_point T>
+struct Convert<T> {
+    static constexpr const char* name = "number";
+    static bool is(lua_State* L, int idx) {
+        return lua_isnumber(L, idx);
+    }
+    static T to(lua_State* L, int idx) {
+        return (T)lua_tonumber(L, idx);
+    }
+    static void push(lua_State* L, T val) {
+        lua_pushnumber(L, val);
+    }
+};
+
+// numbers too, like lua_tostring
+template <>
+struct Convert<std::string> {
+    static constexpr const char* name = "string";
+    static bool is(lua_State* L, int idx) {
+        return lua_isstring(L, idx);
+    }
+    static std::string to(lua_State* L, int idx) {
+        size_t len;
+        const char* s = lua_tolstring(L, idx, &len);
+        return {s, len};
+    }
+    static void push(lua_State* L, const std::string& val) {
+        lua_pushlstring(L, val.data(), val.size());
+    }
+};
+
+// points into the lua string, only good while it is on
+// the stack (for arguments, the whole call)
+template <>
+struct Convert<std::string_view> {
+    static constexpr const char* name = "string";
+    static bool is(lua_State* L, int idx) {
+        return lua_isstring(L, idx);
+    }
+    static std::string_view to(lua_State* L, int idx) {
+        size_t len;
+        const char* s = lua_tolstring(L, idx, &len);
+        return {s, len};
+    }
+    static void push(lua_State* L, std::string_view val) {
+        lua_pushlstring(L, val.data(), val.size());
+    }
+};
+
+// nil when empty
+template <typename T>
+struct Convert<std::optional<T>> {
+    static constexpr const char* name = Convert<T>::name;
+    static bool is(lua_State* L, int idx) {
+        return lua_isnoneornil(L, idx) ||
+               Convert<T>::is(L, idx);
+    }
+    static std::optional<T> to(lua_State* L, int idx) {
+        if (lua_isnoneornil(L, idx))
+            return std::nullopt;
+        return Convert<T>::to(L, idx);
+    }
+    static void push(
+        lua_State* L, const std::optional<T>& val) {
+        if (val)
+            Convert<T>::push(L, *val);
+        else
+            lua_pushnil(L);
+    }
+};
+
+// a lua array, every item is checked
+template <typename T>
+struct Convert<std::vector<T>> {
+    static constexpr const char* name = "array";
+    static bool is(lua_State* L, int idx) {
+        if (!lua_istable(L, idx))
+            return false;
+        idx      = lua_absindex(L, idx);
+        size_t n = lua_rawlen(L, idx);
+        for (size_t i = 0; i < n; ++i) {
+            lua_rawgeti(L, idx, i + 1);
+            bool ok = Convert<T>::is(L, -1);
+            lua_pop(L, 1);
+            if (!ok)
+                return false;
+        }
+        return true;
+    }
+    static std::vector<T> to(lua_State* L, int idx) {
+        idx      = lua_absindex(L, idx);
+        size_t n = lua_rawlen(L, idx);
+        std::vector<T> out;
+        out.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            lua_rawgeti(L, idx, i + 1);
+            out.push_back(Convert<T>::to(L, -1));
+            lua_pop(L, 1);
+        }
+        return out;
+    }
+    static void push(
+        lua_State* L, const std::vector<T>& val) {
+        lua_createtable(L, val.size(), 0);
+        for (size_t i = 0; i < val.size(); ++i) {
+            Convert<T>::push(L, val[i]);
+            lua_rawseti(L, -2, i + 1);
+        }
+    }
+};
+
+template <>
+struct Convert<ConsoleColor> {
+    static constexpr const char* name = "color";
+    static bool is(lua_State* L, int idx) {
+        ConsoleColor c = ConsoleColor::WHITE;
+        return to_color(L, idx, c);
+    }
+    static ConsoleColor to(lua_State* L, int idx) {
+        ConsoleColor c = ConsoleColor::WHITE;
+        to_color(L, idx, c);
+        return c;
+    }
+    static void push(lua_State* L, ConsoleColor val) {
+        push_color(L, val);
+    }
+};
+
+// "left", "center" or "right"
+template <>
+struct Convert<Align> {
+    static constexpr const char* name = "align";
+    static constexpr const char* names[] = {
+        "left", "center", "right"};
+
+    static int _find(lua_State* L, int idx) {
+        if (lua_type(L, idx) != LUA_TSTRING)
+            return -1;
+        const char* s = lua_tostring(L, idx);
+        for (int i = 0; i < 3; ++i)
+            if (!strcmp(s, names[i]))
+                return i;
+        return -1;
+    }
+    static bool is(lua_State* L, int idx) {
+        return _find(L, idx) >= 0;
+    }
+    static Align to(lua_State* L, int idx) {
+        return (Align)_find(L, idx);
+    }
+    static void push(lua_State* L, Align val) {
+        lua_pushstring(L, names[(int)val]);
+    }
+};
+
+// ----------[classes]----------
+template <typename M>
+struct _Field;
+
+template <typename C, typename F>
+struct _Field<F C::*> {
+    using Type = F;
+};
+
+template <typename M>
+struct _Method;
+
+template <typename C, typename R, typename... A>
+struct _Method<R (C::*)(A...)> {
+    using Ret  = R;
+    using Args = std::tuple<std::decay_t<A>...>;
+};
+
+template <typename C, typename R, typename... A>
+struct _Method<R (C::*)(A...) const>
+    : _Method<R (C::*)(A...)> {};
+
+// marks the metatables of every class with the same Base,
+// the address is the key
+template <typename Base>
+inline char _base_key;
+
+// a class exposed as userdata holding a shared_ptr<Base>
+// to a T. Base is what the rest of the code takes them as
+// (widgets::Widget for the native widgets), T has to
+// derive from it.
+//
+// fields and methods are given as template arguments so
+// each one becomes its own lua_CFunction, decoding its
+// arguments with Convert:
+//
+//     Class<List, Widget>("native.List")
+//         .field<&List::items>("items")
+//         .method<&List::move>("move")
+//         .open(L);
+//
+// the metatable is made once per state and found through
+// the registry by address, never by name
+template <typename T, typename Base = T>
+class Class {
+    static_assert(std::is_base_of_v<Base, T>);
+    using Ptr = std::shared_ptr<Base>;
+
+    // the address is the registry key of the metatable
+    static inline char _key;
+    static inline const char* _name = nullptr;
+
+    std::vector<luaL_Reg> _methods, _getters, _setters;
+
+    // only for the metamethods, lua already checked self
+    static T& _self(lua_State* L) {
+        return static_cast<T&>(
+            **static_cast<Ptr*>(lua_touserdata(L, 1)));
+    }
+
+    // methods can be called with anything as self
+    static T& _check_self(lua_State* L) {
+        T* self = test(L, 1);
+        if (!self)
+            luaL_typeerror(L, 1, _name);
+        return *self;
+    }
+
+    template <auto F>
+    static int _get(lua_State* L) {
+        using Ty = typename _Field<decltype(F)>::Type;
+        Convert<Ty>::push(L, _self(L).*F);
+        return 1;
+    }
+
+    template <auto F>
+    static int _set(lua_State* L) {
+        using Ty = typename _Field<decltype(F)>::Type;
+        _expect<Convert<Ty>>(L, 3);
+        _self(L).*F = Convert<Ty>::to(L, 3);
+        return 0;
+    }
+
+    template <typename Args, size_t I>
+    using _Arg = Convert<std::tuple_element_t<I, Args>>;
+
+    // arguments start at 2, after self
+    template <auto M, size_t... I>
+    static int _call(
+        lua_State* L, std::index_sequence<I...>) {
+        using Ret  = typename _Method<decltype(M)>::Ret;
+        using Args = typename _Method<decltype(M)>::Args;
+        T& self    = _check_self(L);
+
+        // all of them before building any
+        (_expect<_Arg<Args, I>>(L, I + 2), ...);
+
+        if constexpr (std::is_void_v<Ret>) {
+            (self.*M)(_Arg<Args, I>::to(L, I + 2)...);
+            return 0;
+        }
+        else {
+            using R = Convert<std::decay_t<Ret>>;
+            R::push(L,
+                (self.*M)(_Arg<Args, I>::to(L, I + 2)...));
+            return 1;
+        }
+    }
+
+    template <auto M>
+    static int _method(lua_State* L) {
+        using Args = typename _Method<decltype(M)>::Args;
+        using Seq  = std::make_index_sequence<
+             std::tuple_size_v<Args>>;
+        return _call<M>(L, Seq{});
+    }
+
+    // params: self, key. upvalues: methods, getters
+    static int _index(lua_State* L) {
+        lua_pushvalue(L, 2);
+        if (lua_rawget(L, lua_upvalueindex(1)) != LUA_TNIL)
+            return 1;
+        lua_pushvalue(L, 2);
+        if (lua_rawget(L, lua_upvalueindex(2)) == LUA_TNIL)
+            return luaL_error(L, "%s has no property '%s'",
+                _name, luaL_tolstring(L, 2, nullptr));
+        lua_CFunction get = lua_tocfunction(L, -1);
+        lua_settop(L, 2);
+        return get(L);
+    }
+
+    // params: self, key, value. upvalues: setters
+    static int _newindex(lua_State* L) {
+        lua_pushvalue(L, 2);
+        if (lua_rawget(L, lua_upvalueindex(1)) == LUA_TNIL)
+            return luaL_error(L, "%s has no property '%s'",
+                _name, luaL_tolstring(L, 2, nullptr));
+        lua_CFunction set = lua_tocfunction(L, -1);
+        lua_settop(L, 3);
+        return set(L);
+    }
+
+    static int _gc(lua_State* L) {
+        static_cast<Ptr*>(lua_touserdata(L, 1))->~Ptr();
+        return 0;
+    }
+
+    // params: table of fields (optional)
+    static int _new(lua_State* L) {
+        push(L, std::make_shared<T>());
+        int self = lua_gettop(L);
+
+        if (lua_istable(L, 1)) {
+            lua_pushnil(L);
+            while (lua_next(L, 1)) {
+                // keep the key for lua_next
+                lua_pushvalue(L, -2);
+                lua_insert(L, -2);
+                lua_settable(L, self);
+            }
+        }
+        return 1;
+    }
+
+    static void _push_regs(
+        lua_State* L, const std::vector<luaL_Reg>& regs) {
+        lua_createtable(L, 0, regs.size());
+        for (const auto& r : regs) {
+            lua_pushcfunction(L, r.func);
+            lua_setfield(L, -2, r.name);
+        }
+    }
+
+public:
+    explicit Class(const char* name) { _name = name; }
+
+    template <auto F>
+    Class& field(const char* name) {
+        this->_getters.push_back({name, _get<F>});
+        this->_setters.push_back({name, _set<F>});
+        return *this;
+    }
+
+    template <auto F>
+    Class& readonly(const char* name) {
+        this->_getters.push_back({name, _get<F>});
+        return *this;
+    }
+
+    template <auto M>
+    Class& method(const char* name) {
+        this->_methods.push_back({name, _method<M>});
+        return *this;
+    }
+
+    // a function written by hand, it has to check self
+    // with test()
+    Class& method(const char* name, lua_CFunction fn) {
+        this->_methods.push_back({name, fn});
+        return *this;
+    }
+
+    // for what doesn't map to a field, get is called with
+    // (self, key) and set with (self, key, value). no set
+    // makes it read only
+    Class& property(const char* name, lua_CFunction get,
+        lua_CFunction set = nullptr) {
+        this->_getters.push_back({name, get});
+        if (set)
+            this->_setters.push_back({name, set});
+        return *this;
+    }
+
+    // makes the metatable in this state
+    void open(lua_State* L) const {
+        luaL_newmetatable(L, _name);
+
+        lua_pushboolean(L, true);
+        lua_rawsetp(L, -2, &_base_key<Base>);
+
+        _push_regs(L, this->_methods);
+        _push_regs(L, this->_getters);
+        lua_pushcclosure(L, _index, 2);
+        lua_setfield(L, -2, "__index");
+
+        _push_regs(L, this->_setters);
+        lua_pushcclosure(L, _newindex, 1);
+        lua_setfield(L, -2, "__newindex");
+
+        lua_pushcfunction(L, _gc);
+        lua_setfield(L, -2, "__gc");
+
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &_key);
+    }
+
+    // a function making new instances, optionally taking a
+    // table with the fields to set
+    static lua_CFunction constructor() { return _new; }
+
+    // the userdata gets one user value, free for
+    // properties to use
+    static void push(lua_State* L, std::shared_ptr<T> obj) {
+        void* mem = lua_newuserdatauv(L, sizeof(Ptr), 1);
+        new (mem) Ptr(std::move(obj));
+        lua_rawgetp(L, LUA_REGISTRYINDEX, &_key);
+        lua_setmetatable(L, -2);
+    }
+
+    // null unless the value at idx is one of these
+    static T* test(lua_State* L, int idx) {
+        void* mem = lua_touserdata(L, idx);
+        if (!mem || !lua_getmetatable(L, idx))
+            return nullptr;
+        lua_rawgetp(L, LUA_REGISTRYINDEX, &_key);
+        bool same = lua_rawequal(L, -1, -2);
+        lua_pop(L, 2);
+        if (!same)
+            return nullptr;
+        return &static_cast<T&>(**static_cast<Ptr*>(mem));
+    }
+};
+
+// the pointer held by any class with this Base, null when
+// the value at idx is not one
+template <typename Base>
+std::shared_ptr<Base>* to_base(lua_State* L, int idx) {
+    void* mem = lua_touserdata(L, idx);
+    if (!mem || !lua_getmetatable(L, idx))
+        return nullptr;
+    bool is =
+        lua_rawgetp(L, -1, &_base_key<Base>) != LUA_TNIL;
+    lua_pop(L, 2);
+    return is ? static_cast<std::shared_ptr<Base>*>(mem)
+              : nullptr;
+}
+
+} // namespace ly::render::lua
+
+#endif
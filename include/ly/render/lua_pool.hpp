@@ -0,0 +1,84 @@
+#ifndef __RENDER_LUA_POOL_HPP__
+#define __RENDER_LUA_POOL_HPP__
+
+#include <ly/int.hpp>
+
+#include <array>
+#include <vector>
+
+namespace ly::render::lua {
+
+// allocator for a lua state. small blocks (strings, tables,
+// closures, userdata) come from free lists of fixed size
+// classes carved out of big chunks, anything bigger goes to
+// malloc. memory of the small blocks is only given back to
+// the system when the pool is destroyed
+class Pool {
+public:
+    // size classes go up by STEP until MAX_SMALL
+    static constexpr size_t STEP      = 16;
+    static constexpr size_t MAX_SMALL = 256;
+    static constexpr size_t CLASSES   = MAX_SMALL / STEP;
+    static constexpr size_t CHUNK     = 16 * 1024;
+
+    struct Stats {
+        // blocks requested and bytes grown, frees and
+        // shrinks are not counted
+        u64 allocs = 0;
+        u64 bytes  = 0;
+        // calls to malloc/realloc, for chunks and big blocks
+        u64 sys_allocs = 0;
+        // bytes handed to lua right now and the most it had
+        size_t in_use = 0;
+        size_t peak   = 0;
+        // bytes taken from the system for small blocks
+        size_t reserved = 0;
+    };
+
+private:
+    struct Free {
+        Free* next;
+    };
+
+    struct Class {
+        Free* free = nullptr;
+        // what is left of the last chunk
+        char* bump = nullptr;
+        char* end  = nullptr;
+    };
+
+    std::array<Class, CLASSES> _classes = {};
+    std::vector<void*> _chunks;
+    Stats _stats = {};
+
+    static size_t _class(size_t size) {
+        return (size - 1) / STEP;
+    }
+
+    void* _small(size_t cls);
+    void _release(void* ptr, size_t size);
+    void* _get(size_t size);
+
+public:
+    Pool() = default;
+    Pool(const Pool&)            = delete;
+    Pool& operator=(const Pool&) = delete;
+    ~Pool();
+
+    // same contract as lua_Alloc, osize is only a size when
+    // ptr is not null
+    void* realloc(void* ptr, size_t osize, size_t nsize);
+
+    // to be given to lua_newstate with the pool as ud
+    static void* lua_alloc(
+        void* ud, void* ptr, size_t osize, size_t nsize) {
+        return static_cast<Pool*>(ud)->realloc(
+            ptr, osize, nsize);
+    }
+
+    const Stats& stats() const { return _stats; }
+};
+
+} // namespace ly::render::lua
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef __RENDER_MPSC_HPP__
+#define __RENDER_MPSC_HPP__
+
+#include <ly/int.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+
+namespace ly::render {
+
+// a bounded queue any thread can push to and one thread
+// pops from, without locks. Every slot has a sequence
+// number telling producers and the consumer whose turn it
+// is (Vyukov's bounded queue). A full queue makes push
+// fail instead of waiting, so producers never block.
+//
+// the slots are made once, values are filled in place and
+// left there after being popped so strings in them keep
+// their capacity
+template <typename T>
+class MpscQueue {
+    struct Slot {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask;
+    alignas(64) std::atomic<size_t> _head = 0;
+    // only touched by the consumer
+    alignas(64) size_t _tail = 0;
+
+public:
+    // rounded up to a power of two
+    explicit MpscQueue(size_t capacity) {
+        size_t cap =
+            std::bit_ceil(std::max<size_t>(capacity, 2));
+        this->_slots = std::make_unique<Slot[]>(cap);
+        this->_mask  = cap - 1;
+        for (size_t i = 0; i < cap; ++i)
+            this->_slots[i].seq.store(
+                i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&)            = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    size_t capacity() const { return this->_mask + 1; }
+
+    // calls fill(T&) on a free slot, false when the queue
+    // is full. Any thread
+    template <typename F>
+    bool try_emplace(F&& fill) {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        size_t pos             = this->_head.load(relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &this->_slots[pos & this->_mask];
+            size_t seq =
+                slot->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (this->_head.compare_exchange_weak(
+                        pos, pos + 1, relaxed))
+                    break;
+            }
+            // the consumer hasn't freed it yet
+            else if (diff < 0) {
+                return false;
+            }
+            // another producer took it, pos is behind
+            else {
+                pos = this->_head.load(relaxed);
+            }
+        }
+
+        fill(slot->value);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(T val) {
+        return this->try_emplace(
+            [&](T& slot) { slot = std::move(val); });
+    }
+
+    // calls fn(T&) on up to max values in the order they
+    // were pushed, returns how many. Only the consumer
+    template <typename F>
+    size_t drain(F&& fn, size_t max = SIZE_MAX) {
+        size_t n = 0;
+        for (; n < max; ++n) {
+            Slot& slot =
+                this->_slots[this->_tail & this->_mask];
+            size_t seq =
+                slot.seq.load(std::memory_order_acquire);
+            if (seq != this->_tail + 1)
+                break;
+            fn(slot.value);
+            slot.seq.store(this->_tail + this->_mask + 1,
+                std::memory_order_release);
+            this->_tail++;
+        }
+        return n;
+    }
+};
+
+} // namespace ly::render
+
+#endif
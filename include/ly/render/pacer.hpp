@@ -0,0 +1,76 @@
+#ifndef __RENDER_PACER_HPP__
+#define __RENDER_PACER_HPP__
+
+#include <ly/int.hpp>
+#include <ly/render/profiler.hpp>
+
+namespace ly::render {
+
+// keeps the frame loop on time.
+//
+// every frame handles input and updates at update_hz, only
+// some of them draw. The pacer measures what a frame that
+// draws and one that doesn't cost, and when drawing every
+// n frames keeps going over the tick it draws less often
+// (down to min_render_hz) until it fits, coming back once
+// there is room again. A frame that starts late gives its
+// draw to the next one, and a loop more than a tick behind
+// starts over from now instead of running frames back to
+// back to catch up
+class FramePacer {
+public:
+    using clock = Profiler::clock;
+
+    struct Config {
+        u32 update_hz = 50;
+        // at most update_hz, 0 is update_hz
+        u32 render_hz     = 0;
+        u32 min_render_hz = 5;
+        // frames in a row the draw rate has to be wrong
+        // before it goes down, it goes up 4 times slower
+        u32 overload_frames = 8;
+    };
+
+private:
+    Config _cfg;
+    clock::duration _tick;
+    // draws every _every frames, between _base and _max
+    u32 _base, _max, _every;
+    u32 _since_draw = 0;
+    // frames the draw rate wanted to go down or up
+    u32 _over = 0, _under = 0;
+    // cost of a frame that draws and of one that doesn't
+    u64 _draw_ns = 0, _nodraw_ns = 0;
+
+    clock::time_point _start, _next;
+    bool _started = false;
+    bool _draw    = false;
+
+    Profiler* _prof = nullptr;
+
+    // smallest cadence that fits the tick
+    u32 _fit() const;
+
+public:
+    FramePacer();
+    FramePacer(Config config);
+
+    void set_profiler(Profiler* prof) { _prof = prof; }
+    const Config& config() const { return _cfg; }
+
+    // starts a frame, true if it should draw
+    bool begin();
+    // the work of the frame is done, before waiting
+    void end();
+    // time left until the next frame
+    u64 idle_ns() const;
+    // sleeps until the next frame
+    void wait() const;
+
+    f64 render_hz() const;
+    bool overloaded() const { return _every > _base; }
+};
+
+} // namespace ly::render
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef __RENDER_PROFILER_HPP__
+#define __RENDER_PROFILER_HPP__
+
+#include <ly/int.hpp>
+
+#include <array>
+#include <chrono>
+
+namespace ly::render {
+
+enum class Phase : u8 {
+    Input,
+    Update,
+    Render,
+    Diff,
+    Encode,
+    Write,
+    // lua collector steps run in the idle time
+    Gc,
+    COUNT,
+};
+
+constexpr size_t PHASE_COUNT = (size_t)Phase::COUNT;
+const char* phase_name(Phase phase);
+
+struct FrameStats {
+    std::array<u64, PHASE_COUNT> phase_ns = {};
+    // time spent working, the sleep is not included
+    u64 busy_ns = 0;
+    // time from the start of the previous frame
+    u64 interval_ns = 0;
+
+    u64 cells_changed = 0;
+    u64 bytes_written = 0;
+    // writes found in the cache of laid out text and the
+    // ones laid out
+    u64 text_hits   = 0;
+    u64 text_misses = 0;
+    u64 lua_calls     = 0;
+    // updates other threads pushed into the State
+    u64 ingested = 0;
+    // async updates left running and the time they took
+    u64 coroutines   = 0;
+    u64 coroutine_ns = 0;
+    // pacing: how late the frame started, 1 when it didn't
+    // draw because of load, the draw rate and 1 when it was
+    // lowered by load
+    u64 late_ns   = 0;
+    u64 skipped   = 0;
+    u64 render_hz = 0;
+    u64 overload  = 0;
+    // done by the lua allocator
+    u64 allocs      = 0;
+    u64 alloc_bytes = 0;
+    // the ones that reached malloc
+    u64 sys_allocs = 0;
+    // bytes lua holds at the end of the frame and the most
+    // it held during it
+    u64 mem_in_use = 0;
+    u64 mem_peak   = 0;
+
+    u64& operator[](Phase p) { return phase_ns[(size_t)p]; }
+    u64 operator[](Phase p) const {
+        return phase_ns[(size_t)p];
+    }
+};
+
+class Profiler {
+public:
+    using clock = std::chrono::steady_clock;
+    static constexpr size_t HISTORY = 128;
+
+    static u64 ns(clock::duration d) {
+        return std::chrono::duration_cast<
+            std::chrono::nanoseconds>(d)
+            .count();
+    }
+
+    class Scope {
+        Profiler* _prof;
+        Phase _phase;
+        clock::time_point _start;
+
+    public:
+        Scope(Profiler* prof, Phase phase)
+            : _prof(prof), _phase(phase) {
+            if (_prof)
+                _start = clock::now();
+        }
+        ~Scope() {
+            if (_prof)
+                _prof->_cur[_phase] +=
+                    ns(clock::now() - _start);
+        }
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    std::array<FrameStats, HISTORY> _ring = {};
+    size_t _head = 0, _size = 0;
+
+    FrameStats _cur = {};
+    clock::time_point _start;
+    clock::time_point _last_start;
+    bool _started = false;
+
+public:
+    void begin_frame();
+    // closes the frame and pushes it to the history
+    void end_frame();
+
+    FrameStats& current() { return _cur; }
+    const FrameStats& current() const { return _cur; }
+
+    // number of finished frames kept
+    size_t size() const { return _size; }
+    // 0 is the last finished frame
+    const FrameStats& get(size_t i) const;
+    // mem_peak is the highest of the history, skipped and
+    // overload are the frames of it that were
+    FrameStats average() const;
+    f64 fps() const;
+};
+
+} // namespace ly::render
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef __RENDER_RECORD_HPP__
+#define __RENDER_RECORD_HPP__
+
+#include <ly/int.hpp>
+#include <ly/render/buffer.hpp>
+#include <ly/render/window.hpp>
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ly::render {
+
+// file layout, everything in host byte order:
+//
+//   header: "LYRC" u32 version
+//   frame:  u32 size (of what follows), u32 runs,
+//           u64 time_ns, u16 width, u16 height,
+//           u16 scroll_top, u16 scroll_bottom, i16 scroll
+//   run:    u16 x, u16 y, u16 len
+//   cell:   u32 fc, u32 bc, u8 attr, u8 glyph_len, glyph
+//
+// frames are appended with a single write each, a frame cut
+// short by a crash is ignored when reading. The first frame
+// and every frame after a resize hold the whole screen
+// so replays don't depend on the state before recording.
+// The scroll is applied before the runs
+namespace record {
+constexpr char MAGIC[4]      = {'L', 'Y', 'R', 'C'};
+constexpr u32 VERSION        = 2;
+constexpr size_t HEADER_SIZE = 8;
+constexpr size_t FRAME_SIZE  = 26;
+constexpr size_t RUN_SIZE    = 6;
+} // namespace record
+
+class FrameRecorder {
+    int _fd;
+    std::string _buf;
+    std::chrono::steady_clock::time_point _start;
+    size_t _width = 0, _height = 0;
+    std::vector<Run> _full;
+
+public:
+    FrameRecorder(const std::string& path);
+    FrameRecorder(const FrameRecorder&)            = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+    ~FrameRecorder();
+
+    // the cells of the runs are read from buf, which
+    // already has the scroll applied
+    void record(const std::vector<Run>& damage,
+        const Buffer& buf,
+        const std::optional<Scroll>& scroll = std::nullopt);
+};
+
+// read only view of a recording through mmap
+class Recording {
+    const u8* _data = nullptr;
+    size_t _size    = 0;
+    size_t _pos     = record::HEADER_SIZE;
+
+public:
+    struct Frame {
+        u64 time_ns;
+        size_t width, height;
+        size_t runs;
+        // 0 when nothing moved
+        long scroll;
+        size_t scroll_top, scroll_bottom;
+        const u8* data;
+        const u8* end;
+
+        // writes the changed cells into buf
+        void apply(Buffer& buf) const;
+    };
+
+    Recording(const std::string& path);
+    Recording(const Recording&)            = delete;
+    Recording& operator=(const Recording&) = delete;
+    ~Recording();
+
+    // false once there are no more complete frames
+    bool next(Frame& frame);
+    void rewind() { _pos = record::HEADER_SIZE; }
+};
+
+} // namespace ly::render
+
+#endif
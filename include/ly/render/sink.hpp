@@ -0,0 +1,95 @@
+#ifndef __RENDER_SINK_HPP__
+#define __RENDER_SINK_HPP__
+
+#include <ly/int.hpp>
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace ly::render {
+
+// where the escape sequences end up
+class TerminalSink {
+protected:
+    u64 _bytes = 0;
+
+public:
+    virtual ~TerminalSink() {}
+
+    virtual void write(const char* data, size_t len) = 0;
+    // makes sure everything written reached the terminal
+    virtual void flush() {}
+    // false when the sink is not a terminal
+    virtual bool size(
+        size_t& /*width*/, size_t& /*height*/) const {
+        return false;
+    }
+    // where the answers of the terminal to queries are read
+    // from, -1 when it can't be asked
+    virtual int input_fd() const { return -1; }
+
+    void write(std::string_view s) { write(s.data(), s.size()); }
+    // total written since creation
+    u64 bytes_written() const { return _bytes; }
+};
+
+// buffered writes to a file descriptor
+class FdSink : public TerminalSink {
+    int _fd;
+    bool _owned;
+    int _input;
+    std::string _buf;
+
+    void _write_all(const char* data, size_t len);
+
+public:
+    // when owned the fd is closed with the sink, input is
+    // where the terminal answers, it is never closed
+    FdSink(int fd, bool owned = false, int input = -1);
+    // opens a tty (or anything else) for writing, the input
+    // of the program is elsewhere so it isn't queried
+    FdSink(const std::string& path);
+    FdSink(const FdSink&)            = delete;
+    FdSink& operator=(const FdSink&) = delete;
+    ~FdSink() override;
+
+    void write(const char* data, size_t len) override;
+    void flush() override;
+    bool size(size_t& width, size_t& height) const override;
+    int input_fd() const override { return _input; }
+    int fd() const { return _fd; }
+};
+
+// keeps everything in memory
+class MemorySink : public TerminalSink {
+    std::string _data;
+
+public:
+    void write(const char* data, size_t len) override;
+
+    const std::string& data() const { return _data; }
+    void clear() { _data.clear(); }
+};
+
+// appends to a file through stdio
+class FileSink : public TerminalSink {
+    FILE* _file;
+
+public:
+    FileSink(const std::string& path);
+    FileSink(const FileSink&)            = delete;
+    FileSink& operator=(const FileSink&) = delete;
+    ~FileSink() override;
+
+    void write(const char* data, size_t len) override;
+    void flush() override;
+};
+
+// shared sink for STDOUT_FILENO, answers come on
+// STDIN_FILENO
+TerminalSink& stdout_sink();
+
+} // namespace ly::render
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef __RENDER_TABLE_VIEW_HPP__
+#define __RENDER_TABLE_VIEW_HPP__
+
+#include <ly/int.hpp>
+#include <ly/render/widgets.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ly::render::widgets {
+
+// the data of a TableView. Only the rows on screen are
+// asked for, so it can be backed by anything. The const
+// functions are also called from the thread sorting the
+// view and have to be safe to call concurrently
+class RowProvider {
+public:
+    virtual ~RowProvider() {}
+
+    virtual size_t columns() const = 0;
+    virtual size_t rows() const    = 0;
+    virtual void header(
+        size_t col, std::string& out) const = 0;
+    // replaces out with the text of the cell
+    virtual void cell(
+        size_t row, size_t col, std::string& out) const = 0;
+};
+
+// a table over a RowProvider that draws in time
+// proportional to its size, not the amount of rows.
+//
+// column widths start at the headers and only grow, with
+// the visible rows and a few sampled ones every frame (up
+// to max_width), so a big dataset settles after some
+// frames without ever being read whole. Sorting runs on its
+// own thread, the view keeps its old order until it is done
+class TableView : public Widget {
+public:
+    // rows read for the column widths per render
+    static constexpr size_t SAMPLE = 256;
+
+private:
+    struct Sort {
+        size_t col;
+        bool descending;
+        // view index -> row
+        std::vector<u32> order;
+    };
+
+    std::shared_ptr<RowProvider> _rows;
+
+    // render clamps it and keeps the widths and the page
+    // (lines of the last render) up to date
+    mutable size_t _offset = 0;
+    mutable size_t _page   = 0;
+    mutable std::vector<size_t> _widths;
+    // rows measured for the widths so far
+    mutable size_t _sampled = 0;
+    // text of the visible cells, reused between renders
+    mutable std::vector<std::string> _cells;
+    mutable std::string _text;
+
+    // the order shown and the one the sorter finished
+    mutable std::optional<Sort> _sort;
+    mutable std::optional<Sort> _done;
+    mutable std::mutex _lock;
+    std::thread _sorter;
+    std::atomic<bool> _cancel  = false;
+    std::atomic<bool> _sorting = false;
+
+    void _stop_sort();
+    void _run_sort(std::shared_ptr<RowProvider> rows,
+        size_t col, bool descending);
+    void _take_sort() const;
+    void _grow(size_t col, const std::string& text) const;
+
+public:
+    ConsoleColor color = ConsoleColor::WHITE;
+    // the header stays on the first row, otherwise it
+    // scrolls away with the first row
+    bool sticky_header = true;
+    // longest a column gets from its cells
+    size_t max_width = 40;
+    // view index, reversed and kept in view
+    std::optional<size_t> selected;
+
+    TableView(std::shared_ptr<RowProvider> rows = nullptr);
+    ~TableView() override;
+
+    void set_rows(std::shared_ptr<RowProvider> rows);
+    RowProvider* rows() const { return _rows.get(); }
+
+    // by rows, stopping at the ends when rendered
+    void scroll(i64 delta);
+    void scroll_to(size_t index) { _offset = index; }
+    size_t offset() const { return _offset; }
+    // like List::move, scrolling to keep it in view
+    void move(i64 delta);
+
+    // sorts by the text of col, numbers by their value. The
+    // current order stays until the new one is ready
+    void sort_by(size_t col, bool descending = false);
+    void unsort();
+    bool sorting() const { return _sorting; }
+    // the row shown at a view index
+    size_t row_at(size_t index) const;
+
+    void render(Buffer& buffer) const override;
+};
+
+} // namespace ly::render::widgets
+
+#endif
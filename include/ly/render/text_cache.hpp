@@ -0,0 +1,76 @@
+#ifndef __RENDER_TEXT_CACHE_HPP__
+#define __RENDER_TEXT_CACHE_HPP__
+
+#include <ly/int.hpp>
+#include <ly/render/buffer.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ly::render {
+
+// runs laid out by Buffer::write, so a label that is the
+// same every frame is decoded and measured once and copied
+// after that.
+//
+// a run is found by the hash of the text, the size of the
+// area and the layout, the text is compared too so a
+// collision is a miss. The color isn't part of it, it is
+// set when the run is copied. When full the least recently
+// used run makes room, the runs and the index are made
+// once and reused, so once their strings grew neither a hit
+// nor a miss allocates
+class TextCache {
+public:
+    static constexpr size_t CAPACITY = 512;
+    // longer text is written without it
+    static constexpr size_t MAX_TEXT = 256;
+
+private:
+    static constexpr u32 NONE = UINT32_MAX;
+
+    struct Entry {
+        u64 hash = 0;
+        std::string text;
+        std::string ellipsis;
+        size_t height = 0;
+        Align align   = Align::Left;
+        bool truncate = false;
+        TextRun run;
+        // the lru list, most recent first
+        u32 prev = NONE, next = NONE;
+    };
+
+    std::vector<Entry> _entries;
+    // linear probing on the hash, indices of _entries
+    std::vector<u32> _index;
+    size_t _size = 0;
+    u32 _first = NONE, _last = NONE;
+    u64 _hits = 0, _misses = 0;
+
+    bool _matches(const Entry& e, u64 hash, size_t w,
+        size_t h, std::string_view text,
+        const TextLayout& layout) const;
+    void _unlink(u32 i);
+    void _push_front(u32 i);
+    void _erase_index(u64 hash, u32 i);
+
+public:
+    TextCache();
+
+    // the run of text written with layout in buf, laid out
+    // on a miss
+    const TextRun& get(const Buffer& buf,
+        std::string_view text, const TextLayout& layout);
+
+    size_t size() const { return _size; }
+    u64 hits() const { return _hits; }
+    u64 misses() const { return _misses; }
+    void clear();
+};
+
+} // namespace ly::render
+
+#endif
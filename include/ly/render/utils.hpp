@@ -1,13 +1,23 @@
 #ifndef __LY_RENDER_UTILS_HPP__
 #define __LY_RENDER_UTILS_HPP__
 
+#include <ly/render/sink.hpp>
+
 namespace ly::render {
 void set_raw_mode();
 void unset_raw_mode();
 
-void reset_cursor();
-void enter_alternate_screen();
-void leave_alternate_screen();
+// installs a SIGWINCH handler that only sets a flag, any
+// number of signals between two calls of take_resize count
+// as one
+void watch_resize();
+bool take_resize();
+
+void reset_cursor(TerminalSink& sink = stdout_sink());
+void enter_alternate_screen(
+    TerminalSink& sink = stdout_sink());
+void leave_alternate_screen(
+    TerminalSink& sink = stdout_sink());
 } // namespace ly::render
 
 #endif
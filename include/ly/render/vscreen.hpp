@@ -0,0 +1,67 @@
+#ifndef __RENDER_VSCREEN_HPP__
+#define __RENDER_VSCREEN_HPP__
+
+#include <ly/int.hpp>
+#include <ly/render/buffer.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ly::render {
+
+// reference model of a terminal, it understands the subset
+// of sequences the encoder emits and is used to check that
+// what is written shows what the window holds
+class VirtualScreen {
+public:
+    // color not set by any SGR yet
+    static constexpr u32 DEFAULT = ~u32(0);
+
+    struct Cell {
+        std::string glyph = " ";
+        u32 fc = DEFAULT, bc = DEFAULT;
+        u8 attr = 0;
+    };
+
+private:
+    size_t _w, _h;
+    std::vector<Cell> _cells;
+    size_t _cx = 0, _cy = 0;
+    bool _wrap = false;
+    // scroll region
+    size_t _top = 0, _bottom;
+    u32 _fc = DEFAULT, _bc = DEFAULT;
+    u8 _attr = 0;
+    std::string _last;
+    // a sequence split between two feeds
+    std::string _pending;
+
+    Cell& _at(size_t x, size_t y) { return _cells[y * _w + x]; }
+    void _print(std::string_view glyph);
+    void _csi(std::string_view params, char final);
+    void _sgr(std::string_view params);
+    void _scroll(long n);
+
+public:
+    VirtualScreen(size_t w, size_t h);
+
+    void feed(std::string_view data);
+
+    const Cell& get(size_t x, size_t y) const {
+        return _cells[y * _w + x];
+    }
+    size_t cursor_x() const { return _cx; }
+    size_t cursor_y() const { return _cy; }
+
+    // the foreground and attributes of blank cells are not
+    // compared, only if they show on a space. why
+    // gets the first difference. The colors of buf are
+    // brought down to depth first
+    bool matches(const Buffer& buf, std::string* why,
+        ColorDepth depth = ColorDepth::TrueColor) const;
+};
+
+} // namespace ly::render
+
+#endif
@@ -2,7 +2,11 @@
 #define __RENDER_WIDGETS_HPP__
 
 #include <ly/render/buffer.hpp>
+#include <ly/render/profiler.hpp>
 #include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace ly::render::widgets {
 
@@ -32,6 +36,94 @@ public:
     virtual void render(Buffer& buffer) const = 0;
 };
 
+// shows the last frame of a profiler
+class StatsOverlay : public Widget {
+    const Profiler& _prof;
+
+public:
+    static constexpr size_t WIDTH  = 24;
+    static constexpr size_t HEIGHT = PHASE_COUNT + 7;
+
+    bool visible = false;
+
+    StatsOverlay(const Profiler& prof) : _prof(prof) {}
+    void render(Buffer& buffer) const override;
+};
+
+// ----------[native widgets]----------
+// text wrapped over the rows, or cut to the first one
+class Label : public Widget {
+public:
+    std::string text;
+    Align align   = Align::Left;
+    bool truncate = false;
+    std::string ellipsis;
+    ConsoleColor color = ConsoleColor::WHITE;
+
+    void render(Buffer& buffer) const override;
+};
+
+// [|||||     ] 42%
+class ProgressBar : public Widget {
+public:
+    // from 0 to 1
+    f64 value        = 0.;
+    bool show_number = false;
+    ConsoleColor color = ConsoleColor::RED;
+
+    void render(Buffer& buffer) const override;
+};
+
+// the background filled up to value with a label centered
+// on top, the percentage when there is no label
+class Gauge : public Widget {
+public:
+    f64 value = 0.;
+    std::string label;
+    ConsoleColor color = ConsoleColor::GREEN;
+
+    void render(Buffer& buffer) const override;
+};
+
+// one item per row, the selected one is reversed and kept
+// in view
+class List : public Widget {
+public:
+    std::vector<std::string> items;
+    std::optional<size_t> selected;
+    ConsoleColor color = ConsoleColor::WHITE;
+
+    // moves the selection by delta items, stopping at the
+    // ends. with nothing selected it starts from the first
+    void move(i64 delta);
+    void render(Buffer& buffer) const override;
+};
+
+// columns as wide as their widest cell, the header in bold.
+// cells that don't fit are cut with an ellipsis
+class Table : public Widget {
+public:
+    std::vector<std::string> headers;
+    std::vector<std::vector<std::string>> rows;
+    ConsoleColor color = ConsoleColor::WHITE;
+
+    void add_row(std::vector<std::string> row) {
+        this->rows.push_back(std::move(row));
+    }
+    void clear() { this->rows.clear(); }
+    void render(Buffer& buffer) const override;
+};
+
+// a border with the title on it and a widget inside
+class Box : public Widget {
+public:
+    std::string title;
+    std::shared_ptr<Widget> child;
+    ConsoleColor color = ConsoleColor::WHITE;
+
+    void render(Buffer& buffer) const override;
+};
+
 } // namespace ly::render::widgets
 
 namespace ly::render {
@@ -3,29 +3,96 @@
 
 #include <ly/int.hpp>
 #include <ly/render/buffer.hpp>
+#include <ly/render/encoder.hpp>
+#include <ly/render/profiler.hpp>
+#include <ly/render/sink.hpp>
+#include <ly/render/text_cache.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace ly::render {
 
+class FrameRecorder;
+
 class Window {
+    // what the terminal shows
     Buffer _front;
-    // TODO: there are possible gains for using the back to
-    // check if there character should be there or not, and
-    // just not render it and just render the differences
     Buffer _back;
     size_t _width, _height;
 
+    // the whole frame is encoded here and written at once
+    std::string _out;
+    Profiler* _prof     = nullptr;
+    TerminalSink* _sink = &stdout_sink();
+    FrameRecorder* _rec = nullptr;
+
+    // cells that changed in the last frame, by row
+    std::vector<Run> _damage;
+    Encoder _encoder;
+    // the next frame is sent whole
+    bool _full = true;
+
+    // rows moved in the last frame, sent before the damage
+    std::optional<Scroll> _scroll;
+    // hash of every row of _front and _back
+    std::vector<u64> _front_hash, _back_hash;
+    std::vector<size_t> _row_cost, _row_len;
+
+    // text written in both buffers, and the counters the
+    // last frame ended with
+    TextCache _text;
+    bool _use_text = true;
+    u64 _text_hits = 0, _text_misses = 0;
+
+    void _attach_text();
+    std::optional<Scroll> _find_scroll();
+    bool _terminal_size(size_t& width, size_t& height);
+    size_t _diff();
+    void _encode();
+    void _write();
+
 public:
     Window();
     ~Window();
 
     void init_buffer();
+    // fixed size, for when there is no terminal
+    void init_buffer(size_t width, size_t height);
 
     Buffer get_subbuf(
         size_t x, size_t y, size_t w, size_t h);
     Buffer& get_buf() { return _back; }
 
     void render();
-    void resize();
+    // follows the size of the terminal, true if it changed.
+    // the buffers keep their storage and the next frame is
+    // sent whole
+    bool resize();
+    bool resize(size_t width, size_t height);
+
+    void set_profiler(Profiler* prof) { _prof = prof; }
+    // the sink has to outlive the window
+    void set_sink(TerminalSink& sink) { _sink = &sink; }
+    TerminalSink& sink() { return *_sink; }
+    // records the damage of every frame, null to stop
+    void set_recorder(FrameRecorder* rec) { _rec = rec; }
+    // text written to the buffers goes through a cache of
+    // laid out runs, on by default
+    void set_text_cache(bool on);
+    const TextCache& text_cache() const { return _text; }
+
+    const std::vector<Run>& damage() const { return _damage; }
+    const std::optional<Scroll>& scroll() const {
+        return _scroll;
+    }
+    const Buffer& front() const { return _front; }
+
+    Encoder& encoder() { return _encoder; }
+    // repaint everything on the next frame, for when the
+    // terminal was touched by something else
+    void invalidate();
 
     ConsoleColor default_bc = ConsoleColor::BLACK;
     ConsoleColor default_fc = ConsoleColor::WHITE;
@@ -10,15 +10,43 @@
 ---@field G integer @[0,255]
 ---@field B integer @[0,255]
 
----@alias Color ColorAnsi | Color8bit
+---@class Color256
+---@field type "256"
+---@field index integer @[0,255] xterm palette
+
+---@alias Color ColorAnsi | Color8bit | Color256
+
+---@class Attrs
+---@field bold? boolean
+---@field dim? boolean
+---@field italic? boolean
+---@field underline? boolean
+---@field reverse? boolean
+---@field strike? boolean
+
+---@alias Align "left" | "center" | "right"
 
 ---@class Buffer
 ---@field set function
+---@field render fun(self: Buffer, text: string | number | table | NativeWidget, align?: Align, truncate?: boolean, ellipsis?: string)
+
+---@class NativeWidget userdata drawn in c++, see the README for the properties of each
+
+---@class native
+---@field label fun(props?: table): NativeWidget
+---@field progress fun(props?: table): NativeWidget
+---@field gauge fun(props?: table): NativeWidget
+---@field list fun(props?: table): NativeWidget
+---@field table fun(props?: table): NativeWidget
+---@field box fun(props?: table): NativeWidget
+---@field log fun(props?: table): NativeWidget
 
 ---@class Widget
 ---@field new function
 ---@field render function
 ---@field update function
+---@field async? boolean update runs as a coroutine, a slice of it every frame
+---@field budget_us? integer time async gets per frame
 
 local letters = ''
 state.on_event('keypress', function(key)
@@ -26,43 +54,13 @@ state.on_event('keypress', function(key)
         state.exit = true;
         return
     end
+    if key == 's' then
+        state.show_stats = not state.show_stats
+        return
+    end
     letters = letters .. key
 end)
 
----@class Widget
-local Bar = widget:extend({
-    new = function(self)
-        local t = self.super.new(self)
-        setmetatable(t, self)
-
-        t._type = "Bar"
-
-        t.percentage = 0.
-        t.show_number = false
-
-        t.__index = self
-        return t
-    end,
-
-    render = function(self, buffer)
-        local x, _ = buffer:get_size()
-
-        if self.show_number and x > 10 then
-            local s = string.format("%.0f%%", self.percentage * 100)
-            buffer:get_sub(x - 7, 1, 7, 1):render(s)
-            x = x - 8
-        end
-
-        buffer:set(1, 1, '[')
-        buffer:set(x, 1, ']')
-
-        local bar_width = x - 2
-        for i = 1, math.floor(bar_width * self.percentage) do
-            buffer:set(i + 1, 1, '|', { type = "bit", r = 1, g = 0, b = 0 })
-        end
-    end
-})
-
 ---@class Widget
 local M_type = widget:extend {
 
@@ -70,9 +68,10 @@ local M_type = widget:extend {
         local t = self.super.new(self)
         setmetatable(t, self)
         t._type = "Bar"
+        -- drawn in c++, see native in the README
         t.bars = {
-            hundrets = Bar:new(),
-            thousands = Bar:new(),
+            hundrets = native.progress {},
+            thousands = native.progress {},
         }
         t.__index = self
         return t
@@ -89,8 +88,8 @@ local M_type = widget:extend {
 
     update = function(self)
         local tick = state.tick or 0
-        self.bars.thousands.percentage = ((tick + self.bars.thousands.percentage) % 1000) / 1000
-        self.bars.hundrets.percentage = ((tick + self.bars.hundrets.percentage) % 100) / 100
+        self.bars.thousands.value = (tick % 1000) / 1000
+        self.bars.hundrets.value = (tick % 100) / 100
     end
 }
 
@@ -1,9 +1,16 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
 #include <memory>
+#include <type_traits>
 #include <ostream>
 #include <utility>
 #include <vector>
 
+#include <ly/exceptions.hpp>
 #include <ly/render/buffer.hpp>
+#include <ly/render/text_cache.hpp>
 
 namespace ly::render {
 const ConsoleColor ConsoleColor::BLACK =
@@ -24,6 +31,7 @@ const ConsoleColor ConsoleColor::WHITE =
     ConsoleColor(ConsoleColor::_ColorUnion::_BitCol::WHITE);
 } // namespace ly::render
 
+using namespace ly;
 using namespace ly::render;
 
 bool ConsoleColor::operator==(
@@ -35,36 +43,226 @@ bool ConsoleColor::operator==(
     if (this->_ty == ConsoleColor::Bit) {
         return this->dt.bit_col == other.dt.bit_col;
     }
+    if (this->_ty == ConsoleColor::Indexed256) {
+        return this->dt.index == other.dt.index;
+    }
     return this->dt.true_col == other.dt.true_col;
 }
 
-void ConsoleColor::display_bc() {
+ConsoleColor ConsoleColor::indexed(u8 index) {
+    ConsoleColor col(Color<u8>{});
+    col._ty      = Indexed256;
+    col.dt.index = index;
+    return col;
+}
+
+u32 ConsoleColor::pack() const {
     switch (this->_ty) {
     case Bit:
-        printf("\e[4%dm", (int)this->dt.bit_col);
+        return (u32)this->dt.bit_col;
+    case Indexed256:
+        return (2u << 24) | this->dt.index;
+    case TrueColor:
+    default:
+        return (1u << 24) | (this->dt.true_col.r << 16) |
+               (this->dt.true_col.g << 8) | this->dt.true_col.b;
+    }
+}
+
+ConsoleColor ConsoleColor::unpack(u32 packed) {
+    if ((packed >> 24) == 1) {
+        return ConsoleColor(Color<u8>{(u8)(packed >> 16),
+            (u8)(packed >> 8), (u8)packed});
+    }
+    if ((packed >> 24) == 2)
+        return ConsoleColor::indexed((u8)packed);
+    return ConsoleColor((int)(packed & 0b111));
+}
+
+// ----------[quantization]----------
+// xterm's default ansi colors
+static constexpr Color<u8> _ansi[16] = {
+    {0, 0, 0},
+    {205, 0, 0},
+    {0, 205, 0},
+    {205, 205, 0},
+    {0, 0, 238},
+    {205, 0, 205},
+    {0, 205, 205},
+    {229, 229, 229},
+    {127, 127, 127},
+    {255, 0, 0},
+    {0, 255, 0},
+    {255, 255, 0},
+    {92, 92, 255},
+    {255, 0, 255},
+    {0, 255, 255},
+    {255, 255, 255},
+};
+
+static constexpr u8 _cube[6] = {0, 95, 135, 175, 215, 255};
+
+static Color<u8> _palette(u8 index) {
+    if (index < 16)
+        return _ansi[index];
+    if (index < 232) {
+        index -= 16;
+        return {_cube[index / 36], _cube[index / 6 % 6],
+            _cube[index % 6]};
+    }
+    u8 g = 8 + (index - 232) * 10;
+    return {g, g, g};
+}
+
+static int _dist(Color<u8> a, Color<u8> b) {
+    int dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+    // weighted towards green like the eye
+    return 2 * dr * dr + 4 * dg * dg + 3 * db * db;
+}
+
+// nearest palette entry for every color with 5 bits per
+// channel, built once on first use
+struct _Quantizer {
+    static constexpr size_t BITS = 5;
+    static constexpr size_t SIZE = 1 << (3 * BITS);
+
+    u8 to256[SIZE];
+    u8 to16[SIZE];
+
+    static size_t key(Color<u8> c) {
+        constexpr size_t s = 8 - BITS;
+        return (c.r >> s) << (2 * BITS) | (c.g >> s) << BITS |
+               (c.b >> s);
+    }
+
+    _Quantizer() {
+        constexpr size_t s    = 8 - BITS;
+        constexpr size_t half = 1 << (s - 1);
+        for (size_t k = 0; k < SIZE; ++k) {
+            // center of the bucket
+            Color<u8> c = {
+                (u8)(((k >> (2 * BITS)) << s) | half),
+                (u8)((((k >> BITS) & 31) << s) | half),
+                (u8)(((k & 31) << s) | half),
+            };
+
+            // only the cube and the grays, 0-15 depend on
+            // the terminal theme
+            int best = INT32_MAX;
+            for (size_t i = 16; i < 256; ++i) {
+                int d = _dist(c, _palette(i));
+                if (d < best) {
+                    best     = d;
+                    to256[k] = i;
+                }
+            }
+
+            best = INT32_MAX;
+            for (size_t i = 0; i < 16; ++i) {
+                int d = _dist(c, _ansi[i]);
+                if (d < best) {
+                    best    = d;
+                    to16[k] = i;
+                }
+            }
+        }
+    }
+
+    static const _Quantizer& get() {
+        static const _Quantizer q;
+        return q;
+    }
+};
+
+ConsoleColor ConsoleColor::downsample(ColorDepth depth) const {
+    u8 index;
+    switch (this->_ty) {
+    case Bit:
+        return *this;
+    case Indexed256:
+        index = this->dt.index;
+        if (depth == ColorDepth::Ansi16 && index >= 16) {
+            size_t k = _Quantizer::key(_palette(index));
+            index    = _Quantizer::get().to16[k];
+        }
         break;
     case TrueColor:
-        printf("\e[48;2;%d;%d;%dm", this->dt.true_col.r,
-            this->dt.true_col.g, this->dt.true_col.b);
+    default:
+        if (depth == ColorDepth::TrueColor)
+            return *this;
+        {
+            size_t k = _Quantizer::key(this->dt.true_col);
+            index    = depth == ColorDepth::Indexed256
+                           ? _Quantizer::get().to256[k]
+                           : _Quantizer::get().to16[k];
+        }
         break;
     }
+
+    if (index < 8)
+        return ConsoleColor((int)index);
+    return ConsoleColor::indexed(index);
 }
 
-void ConsoleColor::display_fc() {
+void ConsoleColor::sgr_params(std::string& out, bool fg) const {
+    char seq[20];
+    int len = 0;
     switch (this->_ty) {
     case Bit:
-        printf("\e[3%dm", (int)this->dt.bit_col);
+        len = snprintf(seq, sizeof(seq), "%d%d", fg ? 3 : 4,
+            (int)this->dt.bit_col);
+        break;
+    // the 16 ansi colors have short forms, 3x/4x and the
+    // bright 9x/10x
+    case Indexed256:
+        if (this->dt.index < 8)
+            len = snprintf(seq, sizeof(seq), "%d%d", fg ? 3 : 4,
+                this->dt.index);
+        else if (this->dt.index < 16)
+            len = snprintf(seq, sizeof(seq), "%d",
+                (fg ? 90 : 100) + this->dt.index - 8);
+        else
+            len = snprintf(seq, sizeof(seq), "%d;5;%d",
+                fg ? 38 : 48, this->dt.index);
         break;
     case TrueColor:
-        printf("\e[38;2;%d;%d;%dm", this->dt.true_col.r,
+        len = snprintf(seq, sizeof(seq), "%d;2;%d;%d;%d",
+            fg ? 38 : 48, this->dt.true_col.r,
             this->dt.true_col.g, this->dt.true_col.b);
         break;
     }
+    out.append(seq, len);
+}
+
+void ConsoleColor::display_bc(std::string& out) const {
+    out += "\e[";
+    this->sgr_params(out, false);
+    out += 'm';
+}
+
+void ConsoleColor::display_fc(std::string& out) const {
+    out += "\e[";
+    this->sgr_params(out, true);
+    out += 'm';
 }
 
 Unit::Unit()
     : fc(ConsoleColor::WHITE), bc(ConsoleColor::BLACK) {}
 
+bool Unit::operator==(const Unit& other) const {
+    return this->data == other.data && this->fc == other.fc &&
+           this->bc == other.bc && this->attr == other.attr;
+}
+
+// cells are filled and moved around as plain memory
+static_assert(sizeof(Glyph) == Glyph::CAPACITY + 1);
+static_assert(std::is_trivially_copyable_v<Unit>);
+
+std::ostream& render::operator<<(
+    std::ostream& os, const Glyph& g) {
+    return os << g.view();
+}
+
 static size_t utf8_char_length(unsigned char c) {
     if ((c & 0b10000000) == 0)
         return 1;
@@ -77,6 +275,23 @@ static size_t utf8_char_length(unsigned char c) {
     return 1; // fallback, invalid UTF-8
 }
 
+// bytes of the glyph at the start of s, a sequence cut
+// short takes what is left
+static size_t _glyph_len(std::string_view s) {
+    return std::min(utf8_char_length(s[0]), s.size());
+}
+
+size_t render::glyph_len(std::string_view s) {
+    return _glyph_len(s);
+}
+
+size_t render::glyph_count(std::string_view s) {
+    size_t n = 0;
+    for (size_t i = 0; i < s.size(); n++)
+        i += _glyph_len(s.substr(i));
+    return n;
+}
+
 Su8::Su8(const char* str) {
     const char* p = str;
     while (*p) {
@@ -122,23 +337,14 @@ Buffer::Buffer(
     size_t w, size_t h, ConsoleColor fg, ConsoleColor bg)
     : _x(0), _y(0), _w(w), _h(h) {
 
-    _Buffer buf =
-        std::make_shared<std::vector<std::vector<Unit>>>();
-    buf->resize(w);
-
-    for (size_t i = 0; i < w; ++i) {
-        std::vector<Unit> col = {};
-
-        for (size_t j = 0; j < h; ++j) {
-            Unit u;
-            u.fc = fg;
-            u.bc = bg;
-            col.push_back(u);
-        }
+    Unit blank;
+    blank.fc = fg;
+    blank.bc = bg;
 
-        (*buf)[i] = col;
-    }
-    this->_data = buf;
+    this->_data         = std::make_shared<_Storage>();
+    this->_data->width  = w;
+    this->_data->height = h;
+    this->_data->cells.assign(w * h, blank);
 }
 
 Buffer::Buffer(const Buffer& other)
@@ -183,24 +389,17 @@ Unit& Buffer::get(size_t x, size_t y) const {
     x += this->_x;
     y += this->_y;
 
-    if (x >= (*_data).size())
-        x = (*_data).size() - 1;
-    if (y >= (*_data)[x].size())
-        y = (*_data)[x].size() - 1;
+    auto& st = *this->_data;
+    if (x >= st.width)
+        x = st.width - 1;
+    if (y >= st.height)
+        y = st.height - 1;
 
-    return (*this->_data)[x][y];
+    return st.cells[y * st.width + x];
 }
 
 Unit& Buffer::get(size_t x, size_t y) {
-    x += this->_x;
-    y += this->_y;
-
-    if (x >= (*_data).size())
-        x = (*_data).size() - 1;
-    if (y >= (*_data)[x].size())
-        y = (*_data)[x].size() - 1;
-
-    return (*this->_data)[x][y];
+    return std::as_const(*this).get(x, y);
 }
 
 std::ostream& operator<<(
@@ -220,3 +419,208 @@ const size_t Buffer::width() const {
 const size_t Buffer::height() const {
     return this->_h;
 };
+
+void Buffer::resize(
+    size_t w, size_t h, ConsoleColor fg, ConsoleColor bg) {
+    if (this->_x != 0 || this->_y != 0)
+        LY_THROW("a sub buffer can't be resized");
+
+    Unit blank;
+    blank.fc = fg;
+    blank.bc = bg;
+
+    auto& st     = *this->_data;
+    auto& cells  = st.cells;
+    size_t old_w = st.width;
+    size_t rows  = std::min(st.height, h);
+    size_t cols  = std::min(old_w, w);
+
+    // the rows that stay move to their new place, forwards
+    // when the rows get shorter and backwards when longer
+    if (w > old_w)
+        cells.resize(w * h, blank);
+    if (w < old_w) {
+        for (size_t y = 1; y < rows; ++y)
+            std::copy_n(cells.begin() + y * old_w, cols,
+                cells.begin() + y * w);
+    }
+    else if (w > old_w) {
+        for (size_t y = rows; y-- > 1;)
+            std::copy_backward(cells.begin() + y * old_w,
+                cells.begin() + y * old_w + cols,
+                cells.begin() + y * w + cols);
+    }
+    cells.resize(w * h, blank);
+
+    for (size_t y = 0; y < h; ++y) {
+        size_t keep = y < rows ? cols : 0;
+        std::fill(cells.begin() + y * w + keep,
+            cells.begin() + (y + 1) * w, blank);
+    }
+
+    st.width  = w;
+    st.height = h;
+    this->_w  = w;
+    this->_h  = h;
+}
+
+void Buffer::shift_rows(size_t top, size_t bottom, long n) {
+    if (bottom >= this->_h)
+        bottom = this->_h - 1;
+    size_t d = n > 0 ? n : -n;
+    if (top > bottom || d == 0 || d > bottom - top)
+        return;
+
+    if (n > 0) {
+        for (size_t y = top; y + d <= bottom; ++y)
+            std::copy_n(&this->get(0, y + d), this->_w,
+                &this->get(0, y));
+    }
+    else {
+        for (size_t y = bottom; y >= top + d; --y)
+            std::copy_n(&this->get(0, y - d), this->_w,
+                &this->get(0, y));
+    }
+}
+
+void Buffer::clear(ConsoleColor fg, ConsoleColor bg) {
+    Unit blank;
+    blank.fc = fg;
+    blank.bc = bg;
+
+    auto& st = *this->_data;
+    // whole rows are one range
+    if (this->_x == 0 && this->_w == st.width &&
+        this->_y + this->_h <= st.height) {
+        Unit* first = &this->get(0, 0);
+        std::fill(first, first + this->_w * this->_h, blank);
+        return;
+    }
+    // only the part of it that is in the storage
+    if (this->_x >= st.width)
+        return;
+    size_t w = std::min(this->_w, st.width - this->_x);
+    for (size_t y = 0;
+        y < this->_h && this->_y + y < st.height; ++y)
+        std::fill_n(&this->get(0, y), w, blank);
+}
+
+void Buffer::swap(Buffer& other) {
+    std::swap(this->_data, other._data);
+    std::swap(this->_x, other._x);
+    std::swap(this->_y, other._y);
+    std::swap(this->_w, other._w);
+    std::swap(this->_h, other._h);
+}
+
+// ----------[text]----------
+// where write puts the glyphs of text
+struct _Plan {
+    // glyphs shown, from kept on they are the ellipsis
+    size_t shown = 0, kept = 0;
+    size_t rows = 0, pad = 0;
+    std::string_view ellipsis = {};
+};
+
+static _Plan _plan(std::string_view text, size_t w,
+    size_t h, const TextLayout& layout) {
+    _Plan p;
+    if (layout.truncate)
+        h = std::min<size_t>(h, 1);
+    size_t cap = w * h;
+    size_t n   = glyph_count(text);
+    if (cap == 0 || n == 0)
+        return p;
+
+    // the ellipsis takes the place of the last glyphs
+    p.shown = std::min(n, cap);
+    p.kept  = p.shown;
+    if (n > cap && !layout.ellipsis.empty()) {
+        p.ellipsis = layout.ellipsis;
+        p.kept -= std::min(glyph_count(p.ellipsis), cap);
+    }
+
+    p.rows = (p.shown + w - 1) / w;
+    p.pad  = p.rows * w - p.shown;
+    if (layout.align == Align::Left)
+        p.pad = 0;
+    else if (layout.align == Align::Center)
+        p.pad /= 2;
+    return p;
+}
+
+// calls fn(i, glyph) for the glyphs shown
+template <typename F>
+static void _each_glyph(
+    std::string_view text, const _Plan& p, F&& fn) {
+    std::string_view src = text;
+    for (size_t i = 0; i < p.shown; ++i) {
+        if (i == p.kept)
+            src = p.ellipsis;
+        size_t len = _glyph_len(src);
+        fn(i, src.substr(0, len));
+        src.remove_prefix(len);
+    }
+}
+
+size_t Buffer::write(
+    std::string_view text, const TextLayout& layout) {
+    TextCache* cache = this->_data->text;
+    if (cache && text.size() <= TextCache::MAX_TEXT)
+        return this->put(
+            cache->get(*this, text, layout), layout.color);
+
+    size_t w = this->_w;
+    _Plan p  = _plan(text, w, this->_h, layout);
+    _each_glyph(text, p, [&](size_t i, std::string_view g) {
+        size_t y = i / w;
+        size_t x = i % w + (y == p.rows - 1 ? p.pad : 0);
+        auto& u  = this->get(x, y);
+        u.data.assign(g.data(), g.size());
+        u.fc = layout.color;
+    });
+    return p.shown;
+}
+
+void Buffer::layout(std::string_view text,
+    const TextLayout& layout, TextRun& out) const {
+    _Plan p   = _plan(text, this->_w, this->_h, layout);
+    out.width = this->_w;
+    out.rows  = p.rows;
+    out.pad   = p.pad;
+    out.glyphs.clear();
+    out.glyphs.reserve(p.shown);
+    _each_glyph(text, p, [&](size_t, std::string_view g) {
+        out.glyphs.emplace_back(g);
+    });
+}
+
+size_t Buffer::put(const TextRun& run, ConsoleColor color) {
+    const auto& st = *this->_data;
+    const Glyph* g = run.glyphs.data();
+    size_t left    = run.glyphs.size();
+    for (size_t y = 0; y < run.rows; ++y) {
+        size_t x   = y == run.rows - 1 ? run.pad : 0;
+        size_t len = std::min(run.width, left);
+        // a row inside the cells is one range, get clamps
+        // the ones that aren't
+        if (this->_x + x + len <= st.width &&
+            this->_y + y < st.height) {
+            Unit* u = &this->get(x, y);
+            for (size_t i = 0; i < len; ++i) {
+                u[i].data = g[i];
+                u[i].fc   = color;
+            }
+        }
+        else {
+            for (size_t i = 0; i < len; ++i) {
+                auto& u = this->get(x + i, y);
+                u.data  = g[i];
+                u.fc    = color;
+            }
+        }
+        g += len;
+        left -= len;
+    }
+    return run.glyphs.size();
+}
@@ -0,0 +1,520 @@
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <ly/render/encoder.hpp>
+
+using namespace ly;
+using namespace ly::render;
+
+static size_t _digits(size_t n) {
+    size_t d = 1;
+    while (n >= 10) {
+        n /= 10;
+        d++;
+    }
+    return d;
+}
+
+static void _number(std::string& out, size_t n) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), n);
+    out.append(buf, res.ptr);
+}
+
+// CSI n final, n is left out when it is 1
+static size_t _csi_len(size_t n) {
+    return 3 + (n == 1 ? 0 : _digits(n));
+}
+
+static void _csi(std::string& out, size_t n, char final) {
+    out += "\e[";
+    if (n != 1)
+        _number(out, n);
+    out += final;
+}
+
+static size_t _cup_len(size_t x, size_t y) {
+    if (x == 0)
+        return y == 0 ? 3 : 3 + _digits(y + 1);
+    return 4 + _digits(y + 1) + _digits(x + 1);
+}
+
+static void _cup(std::string& out, size_t x, size_t y) {
+    out += "\e[";
+    if (x != 0 || y != 0)
+        _number(out, y + 1);
+    if (x != 0) {
+        out += ';';
+        _number(out, x + 1);
+    }
+    out += 'H';
+}
+
+static constexpr std::string_view _sync_begin = "\e[?2026h";
+static constexpr std::string_view _sync_end   = "\e[?2026l";
+
+// a space only shows its background
+static bool _is_blank(const Unit& u) {
+    return u.data == " " && !(u.attr & attr::VISIBLE);
+}
+
+// SGR parameters to turn attributes on and off
+static constexpr struct {
+    u8 bit;
+    int on, off;
+} _attrs[] = {
+    {attr::BOLD, 1, 22},
+    {attr::DIM, 2, 22},
+    {attr::ITALIC, 3, 23},
+    {attr::UNDERLINE, 4, 24},
+    {attr::REVERSE, 7, 27},
+    {attr::STRIKE, 9, 29},
+};
+
+static void _param(std::string& out, int n) {
+    if (!out.empty())
+        out += ';';
+    _number(out, n);
+}
+
+static ColorDepth _detect_depth(const char* term) {
+    const char* colorterm = getenv("COLORTERM");
+    if (colorterm && (strcmp(colorterm, "truecolor") == 0 ||
+                         strcmp(colorterm, "24bit") == 0))
+        return ColorDepth::TrueColor;
+    if (!term)
+        return ColorDepth::TrueColor;
+
+    if (strstr(term, "256color"))
+        return ColorDepth::Indexed256;
+    if (strstr(term, "direct"))
+        return ColorDepth::TrueColor;
+
+    // terminfo entries that only promise the ansi colors
+    static const char* ansi[] = {
+        "xterm", "screen", "tmux", "linux", "vt100", "dumb"};
+    for (auto t : ansi)
+        if (strcmp(term, t) == 0)
+            return ColorDepth::Ansi16;
+
+    // most of what is left are newer terminals
+    return ColorDepth::TrueColor;
+}
+
+TermCaps ly::render::detect_caps() {
+    TermCaps caps;
+    const char* term = getenv("TERM");
+    caps.colors      = _detect_depth(term);
+    if (!term)
+        return caps;
+
+    // terminals known to implement REP
+    static const char* rep[] = {
+        "xterm-kitty", "foot", "wezterm", "xterm-ghostty"};
+    for (auto t : rep)
+        if (strncmp(term, t, strlen(t)) == 0)
+            caps.rep = true;
+
+    // the vt100 and dumb terminals don't know ECH or SU
+    if (strcmp(term, "dumb") == 0 ||
+        strncmp(term, "vt100", 5) == 0) {
+        caps.erase  = false;
+        caps.scroll = false;
+    }
+
+    return caps;
+}
+
+bool ly::render::query_sync_output(
+    TerminalSink& sink, std::string& rest, int timeout_ms) {
+    int fd = sink.input_fd();
+    if (fd < 0)
+        return false;
+
+    // DA1 goes after DECRQM, every terminal answers it so
+    // there is no need to wait the whole timeout when the
+    // first one is ignored
+    sink.write("\e[?2026$p\e[c");
+    sink.flush();
+
+    std::string reply;
+    char buf[64];
+    size_t da = std::string::npos, da_end = 0;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    while (da == std::string::npos &&
+           poll(&pfd, 1, timeout_ms) > 0) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        reply.append(buf, n);
+
+        // the DA1 answer, \e[?...c
+        da = reply.find("\e[?");
+        while (da != std::string::npos) {
+            size_t end = reply.find_first_not_of(
+                "0123456789;", da + 3);
+            if (end != std::string::npos &&
+                reply[end] == 'c') {
+                da_end = end + 1;
+                break;
+            }
+            da = reply.find("\e[?", da + 3);
+        }
+    }
+
+    // \e[?2026;Ps$y, 1 and 2 are set and reset, 0 unknown
+    // and 4 permanently reset
+    constexpr std::string_view prefix = "\e[?2026;";
+    bool sync     = false;
+    size_t at     = reply.find(prefix);
+    size_t at_end = reply.find("$y", at);
+    if (at != std::string::npos &&
+        at_end != std::string::npos) {
+        char ps = reply[at + prefix.size()];
+        sync    = ps == '1' || ps == '2';
+    }
+    else {
+        at = std::string::npos;
+    }
+
+    // whatever isn't one of the answers was typed while
+    // waiting, the later answer is cut first
+    auto cut = [&](size_t from, size_t to) {
+        if (from != std::string::npos)
+            reply.erase(from, to - from);
+    };
+    if (at != std::string::npos && at > da) {
+        cut(at, at_end + 2);
+        cut(da, da_end);
+    }
+    else {
+        cut(da, da_end);
+        cut(at, at_end + 2);
+    }
+    rest.append(reply);
+    return sync;
+}
+
+void Encoder::invalidate() {
+    this->_cx = UNKNOWN;
+    this->_cy = UNKNOWN;
+    this->_fc.reset();
+    this->_bc.reset();
+    this->_attr.reset();
+}
+
+// bytes needed to reach `to` by printing the cells in
+// between again, SIZE_MAX if they can't be printed with the
+// current colors or it costs more than limit
+size_t Encoder::_reprint_cost(const Buffer& screen,
+    size_t from, size_t to, size_t y, size_t limit) const {
+    if (!this->_fc || !this->_bc || !this->_attr)
+        return SIZE_MAX;
+
+    const auto depth = this->_caps.colors;
+    size_t cost      = 0;
+    for (size_t x = from; x < to; ++x) {
+        const auto& u = screen.get(x, y);
+        if (u.bc.downsample(depth) != *this->_bc)
+            return SIZE_MAX;
+        if (_is_blank(u) && (*this->_attr & attr::VISIBLE))
+            return SIZE_MAX;
+        if (!_is_blank(u) &&
+            (u.fc.downsample(depth) != *this->_fc ||
+                u.attr != *this->_attr))
+            return SIZE_MAX;
+        cost += u.data.size();
+        if (cost >= limit)
+            return SIZE_MAX;
+    }
+    return cost;
+}
+
+void Encoder::_move(const Buffer& screen, size_t x, size_t y,
+    std::string& out) {
+    if (this->_cx == x && this->_cy == y)
+        return;
+
+    enum { Cup, Relative } best = Cup;
+    size_t best_cost            = _cup_len(x, y);
+
+    // vertical then horizontal
+    enum { None, Forward, Back, Return, Reprint } h = None;
+    size_t h_cost                                 = 0;
+    size_t v_cost                                 = 0;
+
+    if (this->_cx != UNKNOWN) {
+        if (y != this->_cy) {
+            size_t dy = y > this->_cy ? y - this->_cy
+                                      : this->_cy - y;
+            v_cost    = _csi_len(dy);
+        }
+
+        if (x == this->_cx) {
+            h = None;
+        }
+        else {
+            // CR (+ CUF) always works
+            h      = Return;
+            h_cost = 1 + (x > 0 ? _csi_len(x) : 0);
+
+            if (x > this->_cx) {
+                size_t n = x - this->_cx;
+                if (_csi_len(n) < h_cost) {
+                    h      = Forward;
+                    h_cost = _csi_len(n);
+                }
+                size_t r = this->_reprint_cost(
+                    screen, this->_cx, x, y, h_cost);
+                if (r < h_cost) {
+                    h      = Reprint;
+                    h_cost = r;
+                }
+            }
+            else {
+                size_t n = this->_cx - x;
+                if (_csi_len(n) < h_cost) {
+                    h      = Back;
+                    h_cost = _csi_len(n);
+                }
+            }
+        }
+
+        if (v_cost + h_cost < best_cost) {
+            best      = Relative;
+            best_cost = v_cost + h_cost;
+        }
+    }
+
+    if (best == Cup) {
+        _cup(out, x, y);
+    }
+    else {
+        if (y > this->_cy)
+            _csi(out, y - this->_cy, 'B');
+        else if (y < this->_cy)
+            _csi(out, this->_cy - y, 'A');
+
+        switch (h) {
+        case None:
+            break;
+        case Forward:
+            _csi(out, x - this->_cx, 'C');
+            break;
+        case Back:
+            _csi(out, this->_cx - x, 'D');
+            break;
+        case Return:
+            out += '\r';
+            if (x > 0)
+                _csi(out, x, 'C');
+            break;
+        case Reprint:
+            for (size_t i = this->_cx; i < x; ++i)
+                out += screen.get(i, y).data;
+            break;
+        }
+    }
+
+    this->_cx = x;
+    this->_cy = y;
+}
+
+// sends what changed of the colors and attributes in one
+// sequence, either as a delta or after a reset, whichever is
+// shorter. blank cells only need the background and none of
+// the attributes that show on a space
+void Encoder::_pen(const Unit& u, bool blank, std::string& out) {
+    const auto depth = this->_caps.colors;
+    auto bc          = u.bc.downsample(depth);
+    auto fc          = u.fc.downsample(depth);
+
+    u8 want = u.attr;
+    if (blank)
+        want = this->_attr ? *this->_attr & ~attr::VISIBLE : 0;
+
+    bool set_bc   = !this->_bc || *this->_bc != bc;
+    bool set_fc   = !blank && (!this->_fc || *this->_fc != fc);
+    bool set_attr = !this->_attr || *this->_attr != want;
+    if (!set_bc && !set_fc && !set_attr)
+        return;
+
+    // everything off and back on
+    auto& reset = this->_reset;
+    reset       = "0";
+    for (const auto& a : _attrs)
+        if (want & a.bit)
+            _param(reset, a.on);
+    reset += ';';
+    bc.sgr_params(reset, false);
+    if (!blank) {
+        reset += ';';
+        fc.sgr_params(reset, true);
+    }
+
+    // only the changes, needs to know the attributes
+    auto& delta = this->_delta;
+    delta.clear();
+    if (this->_attr) {
+        u8 cur = *this->_attr;
+        u8 off = cur & ~want;
+        u8 on  = want & ~cur;
+        // 22 turns off both bold and dim
+        if (off & (attr::BOLD | attr::DIM)) {
+            _param(delta, 22);
+            on |= want & (attr::BOLD | attr::DIM);
+            off &= ~(attr::BOLD | attr::DIM);
+        }
+        for (const auto& a : _attrs)
+            if (off & a.bit)
+                _param(delta, a.off);
+        for (const auto& a : _attrs)
+            if (on & a.bit)
+                _param(delta, a.on);
+        if (set_bc) {
+            if (!delta.empty())
+                delta += ';';
+            bc.sgr_params(delta, false);
+        }
+        if (set_fc) {
+            if (!delta.empty())
+                delta += ';';
+            fc.sgr_params(delta, true);
+        }
+    }
+
+    bool use_reset = !this->_attr || reset.size() < delta.size();
+    out += "\e[";
+    out += use_reset ? reset : delta;
+    out += 'm';
+
+    this->_attr = want;
+    this->_bc   = bc;
+    if (!blank)
+        this->_fc = fc;
+    // the reset went back to the default foreground
+    else if (use_reset)
+        this->_fc.reset();
+}
+
+void Encoder::_scroll(const Buffer& screen,
+    const Scroll& scroll, std::string& out) {
+    const size_t n = scroll.n > 0 ? scroll.n : -scroll.n;
+    // the region is only set when it isn't the whole screen,
+    // setting it moves the cursor home
+    bool region =
+        scroll.top != 0 || scroll.bottom + 1 != screen.height();
+    if (region) {
+        out += "\e[";
+        _number(out, scroll.top + 1);
+        out += ';';
+        _number(out, scroll.bottom + 1);
+        out += 'r';
+    }
+
+    _csi(out, n, scroll.n > 0 ? 'S' : 'T');
+
+    if (region) {
+        out += "\e[r";
+        this->_cx = 0;
+        this->_cy = 0;
+    }
+}
+
+void Encoder::encode(const Buffer& screen,
+    const std::vector<Run>& damage, std::string& out,
+    const Scroll* scroll) {
+    const size_t width = screen.width();
+    const size_t start = out.size();
+    if (this->_caps.sync)
+        out += _sync_begin;
+    if (scroll)
+        this->_scroll(screen, *scroll, out);
+
+    for (size_t i = 0; i < damage.size(); ++i) {
+        const Run& run = damage[i];
+        const size_t y = run.y;
+        const size_t end = run.x + run.len;
+        const bool more_on_row =
+            i + 1 < damage.size() && damage[i + 1].y == y;
+
+        size_t x = run.x;
+        while (x < end) {
+            const Unit& u = screen.get(x, y);
+
+            if (this->_caps.erase && _is_blank(u)) {
+                size_t k = 1;
+                while (x + k < end &&
+                       _is_blank(screen.get(x + k, y)) &&
+                       screen.get(x + k, y).bc == u.bc)
+                    k++;
+
+                // the rest of the row is blank, EL covers it
+                // and whatever damage follows on this row
+                bool tail = x + k == end;
+                for (size_t t = end; tail && t < width; ++t) {
+                    const auto& c = screen.get(t, y);
+                    tail = _is_blank(c) && c.bc == u.bc;
+                }
+
+                if (tail && k > 3) {
+                    this->_move(screen, x, y, out);
+                    this->_pen(u, true, out);
+                    out += "\e[K";
+                    while (i + 1 < damage.size() &&
+                           damage[i + 1].y == y)
+                        i++;
+                    break;
+                }
+
+                // ECH leaves the cursor where it was
+                bool after   = x + k < end || more_on_row;
+                size_t erase = _csi_len(k) +
+                               (after ? _csi_len(k) : 0);
+                if (erase < k) {
+                    this->_move(screen, x, y, out);
+                    this->_pen(u, true, out);
+                    _csi(out, k, 'X');
+                    x += k;
+                    continue;
+                }
+            }
+
+            this->_move(screen, x, y, out);
+            this->_pen(u, _is_blank(u), out);
+            out += u.data;
+
+            // same glyph over and over, only ascii since REP
+            // repeats a single character
+            size_t r = 1;
+            if (this->_caps.rep && u.data.size() == 1) {
+                while (x + r < end && screen.get(x + r, y) == u)
+                    r++;
+                if (r > 1 && _csi_len(r - 1) < r - 1)
+                    _csi(out, r - 1, 'b');
+                else
+                    r = 1;
+            }
+
+            x += r;
+            // writing the last column leaves the cursor in
+            // a pending wrap, don't guess
+            this->_cx = x < width ? x : UNKNOWN;
+            if (this->_cx == UNKNOWN)
+                this->_cy = UNKNOWN;
+        }
+    }
+
+    if (!this->_caps.sync)
+        return;
+    // an empty frame is not worth a begin and end
+    if (out.size() == start + _sync_begin.size())
+        out.resize(start);
+    else
+        out += _sync_end;
+}
@@ -0,0 +1,183 @@
+#include <cstdio>
+#include <cstring>
+
+#include <ly/exceptions.hpp>
+#include <ly/render/lua_bindings.hpp>
+
+#include <utility>
+
+using namespace ly::render;
+using namespace ly::render::lua;
+
+EventId EventBus::intern(std::string_view name) {
+    auto it = this->_ids.find(name);
+    if (it != this->_ids.end())
+        return it->second;
+
+    EventId id = this->_names.size();
+    this->_ids.emplace(std::string(name), id);
+    this->_names.emplace_back(name);
+    this->_entries.emplace_back();
+    return id;
+}
+
+EventId EventBus::find(std::string_view name) const {
+    auto it = this->_ids.find(name);
+    if (it == this->_ids.end())
+        return INVALID;
+    return it->second;
+}
+
+const std::string& EventBus::name(EventId id) const {
+    if (id >= this->_names.size())
+        LY_THROW("invalid event id " << id);
+    return this->_names[id];
+}
+
+void EventBus::set_coalesce(EventId id, bool coalesce) {
+    this->_entries.at(id).coalesce = coalesce;
+}
+
+void EventBus::subscribe(lua_State* L, EventId id, int idx) {
+    lua_pushvalue(L, idx);
+    int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    this->_entries.at(id).handlers.push_back(ref);
+}
+
+bool EventBus::unsubscribe(
+    lua_State* L, EventId id, int idx) {
+    idx            = lua_absindex(L, idx);
+    auto& handlers = this->_entries.at(id).handlers;
+    for (auto it = handlers.begin(); it != handlers.end();
+        ++it) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *it);
+        bool same = lua_rawequal(L, -1, idx);
+        lua_pop(L, 1);
+
+        if (same) {
+            luaL_unref(L, LUA_REGISTRYINDEX, *it);
+            // the handlers after it move back one, so does
+            // the one being called (it wraps from 0 and the
+            // next ++ brings it back)
+            size_t at = it - handlers.begin();
+            if (this->_cursor < this->_dispatching.size() &&
+                this->_dispatching[this->_cursor].id == id &&
+                at <= this->_handler)
+                this->_handler--;
+            handlers.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool EventBus::has_handlers(EventId id) const {
+    return id < this->_entries.size() &&
+           !this->_entries[id].handlers.empty();
+}
+
+EventBus::_Queued& EventBus::_enqueue(EventId id) {
+    auto& entry = this->_entries.at(id);
+    if (entry.coalesce && entry.pending != SIZE_MAX) {
+        auto& q     = this->_queue[entry.pending];
+        q.small_len = 0;
+        q.payload   = Value::none();
+        return q;
+    }
+
+    entry.pending = this->_queue.size();
+    auto& q       = this->_queue.emplace_back();
+    q.id          = id;
+    return q;
+}
+
+void EventBus::post(EventId id, std::string_view payload) {
+    // nobody is listening so there is no point on queueing
+    if (!this->has_handlers(id))
+        return;
+
+    auto& q = this->_enqueue(id);
+    if (payload.size() <= SMALL_PAYLOAD) {
+        std::memcpy(q.small, payload.data(), payload.size());
+        q.small_len = payload.size();
+        // an empty string still has to be pushed as one
+        if (payload.empty())
+            q.payload = Value::string("");
+    }
+    else {
+        q.payload = Value::string(std::string(payload));
+    }
+}
+
+void EventBus::post(EventId id, Value payload) {
+    if (!this->has_handlers(id))
+        return;
+
+    auto& q   = this->_enqueue(id);
+    q.payload = std::move(payload);
+}
+
+// params: lightuserdata bus
+int EventBus::_dispatch_batch(lua_State* L) {
+    auto* bus =
+        static_cast<EventBus*>(lua_touserdata(L, 1));
+
+    for (; bus->_cursor < bus->_dispatching.size();
+        ++bus->_cursor, bus->_handler = 0) {
+        const auto& q = bus->_dispatching[bus->_cursor];
+        // handlers can subscribe while being called, which
+        // can move _entries, so they are looked up by index
+        // every time
+        for (; bus->_handler <
+               bus->_entries[q.id].handlers.size();
+            ++bus->_handler) {
+            int ref =
+                bus->_entries[q.id].handlers[bus->_handler];
+            lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+            if (q.small_len > 0)
+                lua_pushlstring(L, q.small, q.small_len);
+            else
+                push_value(L, q.payload);
+            lua_call(L, 1, 0);
+        }
+    }
+
+    return 0;
+}
+
+size_t EventBus::dispatch(lua_State* L) {
+    if (this->_queue.empty())
+        return 0;
+
+    // events posted by the handlers are left for the next
+    // dispatch
+    std::swap(this->_queue, this->_dispatching);
+    for (auto& entry : this->_entries) entry.pending = SIZE_MAX;
+
+    this->_cursor  = 0;
+    this->_handler = 0;
+    while (this->_cursor < this->_dispatching.size()) {
+        lua_pushcfunction(L, _dispatch_batch);
+        lua_pushlightuserdata(L, this);
+        if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
+            EventId id =
+                this->_dispatching[this->_cursor].id;
+            const char* err = lua_tostring(L, -1);
+            fprintf(stderr, "Lua %s handler error: %s\n",
+                this->_names[id].c_str(),
+                err ? err : "(unknown error)");
+            lua_pop(L, 1);
+            // skip the handler that failed, the others of
+            // the event still get it
+            if (++this->_handler >=
+                this->_entries[id].handlers.size()) {
+                this->_cursor++;
+                this->_handler = 0;
+            }
+        }
+    }
+
+    size_t count = this->_dispatching.size();
+    this->_dispatching.clear();
+    return count;
+}
@@ -0,0 +1,162 @@
+#include <ly/render/log_view.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ly;
+using namespace ly::render;
+using namespace ly::render::widgets;
+
+LogView::LogView() : LogView(Config{}) {}
+
+LogView::LogView(Config config)
+    : _queue(config.queue),
+      _glyphs(std::max(config.glyphs, LINE_BYTES)),
+      _lines(std::max<size_t>(config.lines, 1)) {}
+
+bool LogView::push(
+    std::string_view text, ConsoleColor color) {
+    u32 packed = color.pack();
+    bool ok    = true;
+    while (true) {
+        size_t nl             = text.find('\n');
+        std::string_view line = text.substr(0, nl);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        // cut where a glyph starts
+        if (line.size() > LINE_BYTES) {
+            size_t cut = LINE_BYTES;
+            // continuation bytes are 10xxxxxx
+            while (cut > 0 && ((u8)line[cut] >> 6) == 0b10)
+                cut--;
+            line = line.substr(0, cut);
+        }
+
+        auto fill = [&](Pending& p) {
+            p.color = packed;
+            p.len   = line.size();
+            std::memcpy(p.bytes, line.data(), line.size());
+        };
+        bool queued = this->_queue.try_emplace(fill);
+        if (!queued) {
+            this->_dropped.fetch_add(
+                1, std::memory_order_relaxed);
+            ok = false;
+        }
+
+        // a trailing newline doesn't start another line
+        if (nl == std::string_view::npos ||
+            nl + 1 == text.size())
+            break;
+        text.remove_prefix(nl + 1);
+    }
+    return ok;
+}
+
+void LogView::_store(const Pending& p) const {
+    size_t cap_lines  = this->_lines.size();
+    size_t cap_glyphs = this->_glyphs.size();
+
+    // room for the line and for len glyphs, the most it can
+    // take
+    auto full = [&]() {
+        if (this->_first == this->_next)
+            return false;
+        const Line& oldest =
+            this->_lines[this->_first % cap_lines];
+        return this->_next - this->_first == cap_lines ||
+               this->_glyph_end + p.len - oldest.start >
+                   cap_glyphs;
+    };
+    while (full())
+        this->_first++;
+
+    Line& line = this->_lines[this->_next % cap_lines];
+    line.start = this->_glyph_end;
+    line.color = p.color;
+
+    std::string_view src(p.bytes, p.len);
+    while (!src.empty()) {
+        size_t len = glyph_len(src);
+        Glyph& g   = this->_glyphs[this->_glyph_end++ %
+                                 cap_glyphs];
+        // control characters would move the cursor
+        if ((u8)src[0] < 0x20 || src[0] == 0x7f)
+            g = ' ';
+        else
+            g.assign(src.data(), len);
+        src.remove_prefix(len);
+    }
+    line.len = this->_glyph_end - line.start;
+    this->_next++;
+
+    // scrolled back, the same lines stay in view
+    if (this->_offset) {
+        u64 max       = this->size() - 1;
+        this->_offset = std::min(this->_offset + 1, max);
+    }
+}
+
+size_t LogView::take() const {
+    return this->_queue.drain(
+        [&](Pending& p) { this->_store(p); });
+}
+
+size_t LogView::_height(const Line& line, size_t w) const {
+    return line.len == 0 ? 1 : (line.len + w - 1) / w;
+}
+
+void LogView::scroll(i64 delta) {
+    i64 to        = (i64)this->_offset + delta;
+    i64 max       = this->size() ? this->size() - 1 : 0;
+    this->_offset = std::clamp<i64>(to, 0, max);
+}
+
+void LogView::render(Buffer& buffer) const {
+    size_t w = buffer.width(), h = buffer.height();
+    this->take();
+    if (w == 0 || h == 0 || this->size() == 0)
+        return;
+
+    size_t cap_lines  = this->_lines.size();
+    size_t cap_glyphs = this->_glyphs.size();
+    auto line_at      = [&](u64 i) -> const Line& {
+        return this->_lines[i % cap_lines];
+    };
+
+    // from the bottom line up until the view is full, only
+    // the visible lines are looked at
+    u64 last    = this->_next - 1 - this->_offset;
+    u64 top     = last;
+    size_t rows = this->_height(line_at(last), w);
+    while (rows < h && top > this->_first) {
+        top--;
+        rows += this->_height(line_at(top), w);
+    }
+
+    // the top line loses its first rows when it doesn't fit
+    size_t skip = rows > h ? rows - h : 0;
+    size_t y    = 0;
+    for (u64 i = top; i <= last; ++i) {
+        const Line& line = line_at(i);
+        ConsoleColor fc  = ConsoleColor::unpack(line.color);
+        size_t lh        = this->_height(line, w);
+        for (size_t r = 0; r < lh; ++r) {
+            if (skip) {
+                skip--;
+                continue;
+            }
+            size_t from = r * w;
+            size_t to   = from + w;
+            if (to > line.len)
+                to = line.len;
+            for (size_t x = 0; from + x < to; ++x) {
+                u64 g   = line.start + from + x;
+                auto& u = buffer.get(x, y);
+                u.data  = this->_glyphs[g % cap_glyphs];
+                u.fc    = fc;
+            }
+            y++;
+        }
+    }
+}
@@ -1,10 +1,13 @@
+#include <climits>
 #include <cstdio>
+#include <cstring>
 
 #include <ly/exceptions.hpp>
 #include <ly/render/buffer.hpp>
 #include <ly/render/lua_bindings.hpp>
 #include <ly/render/widgets.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 #include <utility>
@@ -280,8 +283,7 @@ bool lua::Value::operator!=(const lua::Value& other) const {
     return !(*this == other);
 }
 
-static void _push_value(
-    lua_State* L, const lua::Value& val) {
+void lua::push_value(lua_State* L, const lua::Value& val) {
     using namespace lua;
     using Ty = Value::Ty;
 
@@ -310,7 +312,7 @@ static void _push_value(
     case Ty::Map: {
         lua_newtable(L);
         for (const auto& [key, v] : val.as_map()) {
-            _push_value(L, v);
+            push_value(L, v);
             lua_setfield(L, -2, key.c_str());
         }
         break;
@@ -320,7 +322,7 @@ static void _push_value(
         lua_newtable(L);
         const auto& arr = val.as_array();
         for (size_t i = 0; i < arr.size(); ++i) {
-            _push_value(L, arr[i]);
+            push_value(L, arr[i]);
             lua_rawseti(L, -2,
                 static_cast<int>(
                     i + 1)); // Lua arrays are 1-based
@@ -330,7 +332,7 @@ static void _push_value(
     }
 }
 
-static lua::Value to_value(lua_State* L, int index) {
+lua::Value lua::to_value(lua_State* L, int index) {
     using namespace lua;
     switch (lua_type(L, index)) {
     case LUA_TNIL:
@@ -460,12 +462,73 @@ static int _buffer_get_size(lua_State* L) {
     return 2;
 }
 
-static int _buffer_render(lua_State* L) {
-    if (lua_isuserdata(L, 2)) {
-        // TODO: handle userdata
-        std::cerr << "userdata not handled yet";
-        return 0;
+bool lua::to_color(
+    lua_State* L, int index, ConsoleColor& out) {
+    if (!lua_istable(L, index))
+        return false;
+    index = lua_absindex(L, index);
+
+    lua_getfield(L, index, "type");
+    lua_getfield(L, index, "r");
+    lua_getfield(L, index, "g");
+    lua_getfield(L, index, "b");
+    lua_getfield(L, index, "index");
+    const char* ty = lua_tostring(L, -5);
+    int r          = lua_tointeger(L, -4);
+    int g          = lua_tointeger(L, -3);
+    int b          = lua_tointeger(L, -2);
+    int idx        = lua_tointeger(L, -1);
+
+    bool ok = ty != nullptr;
+    if (ok && !strcmp(ty, "bit"))
+        out = ConsoleColor(
+            (r & 1) << 0 | (g & 1) << 1 | (b & 1) << 2);
+    else if (ok && !strcmp(ty, "8bit"))
+        out = ConsoleColor(
+            Color<ly::u8>(r & 0xff, g & 0xff, b & 0xff));
+    else if (ok && !strcmp(ty, "256"))
+        out = ConsoleColor::indexed(idx & 0xff);
+    else
+        ok = false;
+
+    lua_pop(L, 5);
+    return ok;
+}
+
+void lua::push_color(lua_State* L, ConsoleColor color) {
+    u32 packed = color.pack();
+    lua_createtable(L, 0, 4);
+    switch (packed >> 24) {
+    case 0:
+        lua_pushstring(L, "bit");
+        lua_setfield(L, -2, "type");
+        lua_pushinteger(L, packed & 1);
+        lua_setfield(L, -2, "r");
+        lua_pushinteger(L, (packed >> 1) & 1);
+        lua_setfield(L, -2, "g");
+        lua_pushinteger(L, (packed >> 2) & 1);
+        lua_setfield(L, -2, "b");
+        break;
+    case 1:
+        lua_pushstring(L, "8bit");
+        lua_setfield(L, -2, "type");
+        lua_pushinteger(L, (packed >> 16) & 0xff);
+        lua_setfield(L, -2, "r");
+        lua_pushinteger(L, (packed >> 8) & 0xff);
+        lua_setfield(L, -2, "g");
+        lua_pushinteger(L, packed & 0xff);
+        lua_setfield(L, -2, "b");
+        break;
+    default:
+        lua_pushstring(L, "256");
+        lua_setfield(L, -2, "type");
+        lua_pushinteger(L, packed & 0xff);
+        lua_setfield(L, -2, "index");
+        break;
     }
+}
+
+static int _buffer_render(lua_State* L) {
     if (lua_istable(L, 2)) {
         // TODO: handle tables in a semi well done way
         lua_getfield(L, 2, "render");
@@ -485,7 +548,36 @@ static int _buffer_render(lua_State* L) {
     else {
         data = static_cast<Buffer*>(udata);
     }
-    lua::Value val = to_value(L, 2);
+
+    // drawn without going through lua
+    if (lua_isuserdata(L, 2)) {
+        auto* widget = lua::to_native_widget(L, 2);
+        luaL_argcheck(L, widget, 2, "not a native widget");
+        data->render_widget(*widget);
+        return 0;
+    }
+
+    // strings and numbers are copied from the lua string
+    // into the cells
+    int ty = lua_type(L, 2);
+    if (ty == LUA_TSTRING || ty == LUA_TNUMBER) {
+        static const char* aligns[] = {
+            "left", "center", "right", nullptr};
+        TextLayout layout;
+        layout.truncate = lua_toboolean(L, 4);
+        layout.align    = (Align)luaL_checkoption(
+            L, 3, "left", aligns);
+
+        size_t len;
+        const char* str = lua_tolstring(L, 5, &len);
+        if (str)
+            layout.ellipsis = {str, len};
+        str = lua_tolstring(L, 2, &len);
+        data->write({str, len}, layout);
+        return 0;
+    }
+
+    lua::Value val = lua::to_value(L, 2);
     data->render_widget(val);
 
     return 0;
@@ -550,31 +642,28 @@ static int _buffer_set(lua_State* L) {
     }
 
     int color_idx =
-        (top >= 5)
+        (top >= 5 && lua_istable(L, 5))
             ? 5
             : ((top == 4 && lua_istable(L, 4)) ? 4 : 0);
-
-    if (color_idx) {
-        lua_getfield(L, color_idx, "type");
-        lua_getfield(L, color_idx, "r");
-        lua_getfield(L, color_idx, "g");
-        lua_getfield(L, color_idx, "b");
-
-        std::string ty = lua_tostring(L, -4);
-        int r          = lua_tointeger(L, -3);
-        int g          = lua_tointeger(L, -2);
-        int b          = lua_tointeger(L, -1);
-        lua_pop(L, 4);
-
-        if (ty == "bit") {
-            r       = (r & 1) << 0;
-            g       = (g & 1) << 1;
-            b       = (b & 1) << 2;
-            unit.fc = ConsoleColor(r | g | b);
-        }
-        else if (ty == "8bit") {
-            unit.fc = ConsoleColor(Color<ly::u8>(
-                r & 0xff, g & 0xff, b & 0xff));
+    if (color_idx)
+        lua::to_color(L, color_idx, unit.fc);
+
+    // {bold = true, underline = true, ...}
+    if (top >= 6 && lua_istable(L, 6)) {
+        static const std::pair<const char*, ly::u8> names[] = {
+            {"bold", attr::BOLD},
+            {"dim", attr::DIM},
+            {"italic", attr::ITALIC},
+            {"underline", attr::UNDERLINE},
+            {"reverse", attr::REVERSE},
+            {"strike", attr::STRIKE},
+        };
+        unit.attr = 0;
+        for (const auto& [name, bit] : names) {
+            lua_getfield(L, 6, name);
+            if (lua_toboolean(L, -1))
+                unit.attr |= bit;
+            lua_pop(L, 1);
         }
     }
 
@@ -648,13 +737,18 @@ lua::LuaWidget::LuaWidget(std::weak_ptr<lua_State> L)
 }
 
 lua::LuaWidget::LuaWidget(lua::LuaWidget&& W)
-    : _L(W._L), _ref(W._ref) {}
+    : _L(W._L), _ref(W._ref), _co(W._co) {
+    W._ref = LUA_NOREF;
+    W._co  = LUA_NOREF;
+}
 
 lua::LuaWidget& lua::LuaWidget::operator=(
     lua::LuaWidget&& other) {
     this->_L   = other._L;
     this->_ref = other._ref;
+    this->_co  = other._co;
     other._ref = LUA_NOREF;
+    other._co  = LUA_NOREF;
     return *this;
 }
 
@@ -664,21 +758,80 @@ lua::LuaWidget::~LuaWidget() {
         luaL_unref(
             L_lock.get(), LUA_REGISTRYINDEX, this->_ref);
     }
+    if (_co != LUA_NOREF) {
+        luaL_unref(
+            L_lock.get(), LUA_REGISTRYINDEX, this->_co);
+    }
 }
 
 void lua::LuaWidget::update() {
     auto L_lock = this->_L.lock();
     auto Lg     = L_lock.get();
+    lua::State::from_lua(Lg)->count_lua_call();
     lua_rawgeti(Lg, LUA_REGISTRYINDEX, this->_ref);
+
+    lua_getfield(Lg, -1, "async");
+    bool async = lua_toboolean(Lg, -1);
+    lua_pop(Lg, 1);
+    // one that stopped being async still finishes
+    if (async || this->_co != LUA_NOREF) {
+        this->_update_async(Lg);
+        lua_pop(Lg, lua_gettop(Lg));
+        return;
+    }
+
     lua_getfield(Lg, -1, "update");
     lua_pushvalue(Lg, -2);
     lua_call(Lg, 1, 0);
     lua_pop(Lg, lua_gettop(Lg));
 }
 
+// the update runs in a coroutine that is resumed every
+// frame for a slice of time until it returns, a new one is
+// started on the next frame. params: widget
+void lua::LuaWidget::_update_async(lua_State* L) {
+    lua_State* co;
+    int nargs = 0;
+    if (this->_co == LUA_NOREF) {
+        co        = lua_newthread(L);
+        this->_co = luaL_ref(L, LUA_REGISTRYINDEX);
+        lua_getfield(L, -1, "update");
+        lua_pushvalue(L, -2);
+        lua_xmove(L, co, 2);
+        nargs = 1;
+    }
+    else {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, this->_co);
+        co = lua_tothread(L, -1);
+        lua_pop(L, 1);
+    }
+
+    u64 budget_us = State::UPDATE_BUDGET_US;
+    lua_getfield(L, -1, "budget_us");
+    if (lua_isnumber(L, -1))
+        budget_us = std::max<lua_Integer>(
+            lua_tointeger(L, -1), 0);
+    lua_pop(L, 1);
+
+    int status = lua::State::from_lua(L)->resume(
+        co, nargs, budget_us * 1000);
+    if (status == LUA_YIELD)
+        return;
+
+    if (status != LUA_OK) {
+        const char* err = lua_tostring(co, -1);
+        std::cerr << "Lua error: "
+                  << (err ? err : "(unknown error)")
+                  << std::endl;
+    }
+    luaL_unref(L, LUA_REGISTRYINDEX, this->_co);
+    this->_co = LUA_NOREF;
+}
+
 void lua::LuaWidget::render(Buffer& buf) const {
     auto L_lock = this->_L.lock();
     auto Lg     = L_lock.get();
+    lua::State::from_lua(Lg)->count_lua_call();
     lua_rawgeti(Lg, LUA_REGISTRYINDEX, this->_ref);
     lua_getfield(Lg, -1, "render");
     lua_pushvalue(Lg, -2);
@@ -764,33 +917,128 @@ static void init_widget_metatable(lua_State* L) {
 }
 
 // ----------[events & state]----------
-std::unordered_map<std::string, int> _events = {};
-
-// TODO: rework this so State holds _events instead of using
-// globals
+// params: name, function
 static int _state_on_event(lua_State* L) {
+    auto* state = static_cast<lua::State*>(
+        lua_touserdata(L, lua_upvalueindex(1)));
     const char* event = luaL_checkstring(L, 1);
     luaL_checktype(L, 2, LUA_TFUNCTION);
 
-    lua_pushvalue(L, 2);
-    int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    auto& bus = state->events();
+    bus.subscribe(L, bus.intern(event), 2);
 
-    auto it = _events.find(event);
-    if (it != _events.end()) {
-        luaL_unref(L, LUA_REGISTRYINDEX, it->second);
-    }
+    return 0;
+}
+
+// params: name, function
+static int _state_off_event(lua_State* L) {
+    auto* state = static_cast<lua::State*>(
+        lua_touserdata(L, lua_upvalueindex(1)));
+    const char* event = luaL_checkstring(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
 
-    _events[event] = ref;
+    auto& bus = state->events();
+    auto id   = bus.find(event);
+    lua_pushboolean(L, id != lua::EventBus::INVALID &&
+                           bus.unsubscribe(L, id, 2));
 
+    return 1;
+}
+
+// params: name, payload
+static int _state_emit(lua_State* L) {
+    auto* state = static_cast<lua::State*>(
+        lua_touserdata(L, lua_upvalueindex(1)));
+    const char* event = luaL_checkstring(L, 1);
+
+    state->post(event, lua::to_value(L, 2));
     return 0;
 }
 
+// the state table, found through the registry so
+// set_function still reaches it when a script replaces
+// the global
+static char _state_table_key;
+
 static int _state_exec(lua_State* L) {
     lua::State::Fn* fn = static_cast<lua::State::Fn*>(
         lua_touserdata(L, lua_upvalueindex(1)));
     return (*fn)(L);
 }
 
+static void _push_frame(lua_State* L, const FrameStats& f) {
+    lua_createtable(L, 0, PHASE_COUNT + 19);
+    for (size_t p = 0; p < PHASE_COUNT; ++p) {
+        lua_pushnumber(L, f.phase_ns[p] / 1000.);
+        std::string field = phase_name((Phase)p);
+        field += "_us";
+        lua_setfield(L, -2, field.c_str());
+    }
+
+    lua_pushnumber(L, f.busy_ns / 1000.);
+    lua_setfield(L, -2, "busy_us");
+    lua_pushnumber(L, f.interval_ns / 1000.);
+    lua_setfield(L, -2, "frame_us");
+    lua_pushinteger(L, f.cells_changed);
+    lua_setfield(L, -2, "cells_changed");
+    lua_pushinteger(L, f.bytes_written);
+    lua_setfield(L, -2, "bytes_written");
+    lua_pushinteger(L, f.text_hits);
+    lua_setfield(L, -2, "text_hits");
+    lua_pushinteger(L, f.text_misses);
+    lua_setfield(L, -2, "text_misses");
+    lua_pushinteger(L, f.lua_calls);
+    lua_setfield(L, -2, "lua_calls");
+    lua_pushinteger(L, f.ingested);
+    lua_setfield(L, -2, "ingested");
+    lua_pushinteger(L, f.coroutines);
+    lua_setfield(L, -2, "coroutines");
+    lua_pushnumber(L, f.coroutine_ns / 1000.);
+    lua_setfield(L, -2, "coroutine_us");
+    lua_pushnumber(L, f.late_ns / 1000.);
+    lua_setfield(L, -2, "late_us");
+    lua_pushinteger(L, f.skipped);
+    lua_setfield(L, -2, "skipped");
+    lua_pushinteger(L, f.render_hz);
+    lua_setfield(L, -2, "render_hz");
+    lua_pushinteger(L, f.overload);
+    lua_setfield(L, -2, "overload");
+    lua_pushinteger(L, f.allocs);
+    lua_setfield(L, -2, "allocs");
+    lua_pushinteger(L, f.alloc_bytes);
+    lua_setfield(L, -2, "alloc_bytes");
+    lua_pushinteger(L, f.sys_allocs);
+    lua_setfield(L, -2, "sys_allocs");
+    lua_pushinteger(L, f.mem_in_use);
+    lua_setfield(L, -2, "mem");
+    lua_pushinteger(L, f.mem_peak);
+    lua_setfield(L, -2, "mem_peak");
+}
+
+// last frame, average and the busy time of every frame in
+// the history (most recent first)
+static void _push_stats(lua_State* L, const Profiler& prof) {
+    if (prof.size() == 0) {
+        lua_newtable(L);
+        return;
+    }
+
+    _push_frame(L, prof.get(0));
+
+    lua_pushnumber(L, prof.fps());
+    lua_setfield(L, -2, "fps");
+
+    _push_frame(L, prof.average());
+    lua_setfield(L, -2, "avg");
+
+    lua_createtable(L, prof.size(), 0);
+    for (size_t i = 0; i < prof.size(); ++i) {
+        lua_pushnumber(L, prof.get(i).busy_ns / 1000.);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, -2, "history");
+}
+
 static int _state_index(lua_State* L) {
     auto* state = static_cast<lua::State*>(
         lua_touserdata(L, lua_upvalueindex(1)));
@@ -803,15 +1051,13 @@ static int _state_index(lua_State* L) {
         return luaL_error(
             L, "__index expects a string key");
 
-    if (state->func_exitst(key)) {
-        auto& f = state->get_func(key);
-        lua_pushlightuserdata(L, &f);
-        lua_pushcclosure(L, _state_exec, 1);
+    if (state->profiler() && strcmp(key, "stats") == 0) {
+        _push_stats(L, *state->profiler());
         return 1;
     }
 
     auto val = state->get_data(key);
-    _push_value(L, val);
+    lua::push_value(L, val);
     return 1;
 }
 
@@ -827,14 +1073,7 @@ static int _state_newindex(lua_State* L) {
         return luaL_error(
             L, "__newindex expects a string key");
 
-    if (state->func_exitst(key)) {
-        auto& f = state->get_func(key);
-        lua_pushlightuserdata(L, &f);
-        lua_pushcclosure(L, _state_exec, 1);
-        return 1;
-    }
-
-    auto val = to_value(L, 3);
+    auto val = lua::to_value(L, 3);
     state->set_data(key, val);
 
     return 0;
@@ -843,11 +1082,20 @@ static int _state_newindex(lua_State* L) {
 static void init_state_table(
     lua::State& cpp_state, lua_State* L) {
     using namespace lua;
-    lua_createtable(L, 0, 1);
+    lua_createtable(L, 0, 3);
 
-    lua_pushcfunction(L, _state_on_event);
+    lua_pushlightuserdata(L, &cpp_state);
+    lua_pushcclosure(L, _state_on_event, 1);
     lua_setfield(L, -2, "on_event");
 
+    lua_pushlightuserdata(L, &cpp_state);
+    lua_pushcclosure(L, _state_off_event, 1);
+    lua_setfield(L, -2, "off_event");
+
+    lua_pushlightuserdata(L, &cpp_state);
+    lua_pushcclosure(L, _state_emit, 1);
+    lua_setfield(L, -2, "emit");
+
     lua_createtable(L, 0, 2);
 
     lua_pushlightuserdata(L, &cpp_state);
@@ -860,6 +1108,8 @@ static void init_state_table(
 
     lua_setmetatable(L, -2);
 
+    lua_pushvalue(L, -1);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &_state_table_key);
     lua_setglobal(L, "state");
 }
 
@@ -868,40 +1118,148 @@ bool lua::State::should_exit() {
 }
 
 void lua::State::press(char keycode) {
-    auto it = _events.find("keypress");
-    if (it == _events.end()) {
-        LY_THROW("event is not defined");
-        return;
-    }
-
-    int ref = it->second;
-
-    lua_rawgeti(this->_L.get(), LUA_REGISTRYINDEX, ref);
+    this->_events.post(
+        this->_ev_keypress, std::string_view(&keycode, 1));
+}
 
-    std::string k(1, keycode);
-    lua_pushstring(this->_L.get(), k.c_str());
+void lua::State::post(std::string_view event, Value payload) {
+    this->_events.post(
+        this->_events.find(event), std::move(payload));
+}
 
-    if (lua_pcall(this->_L.get(), 1, 0, 0) != LUA_OK) {
-        const char* err = lua_tostring(this->_L.get(), -1);
-        fprintf(stderr, "Lua keypress handler error: %s\n",
-            err);
-        lua_pop(this->_L.get(), 1);
+// ----------[coroutines]----------
+void lua::State::_budget_hook(lua_State* L, lua_Debug*) {
+    State* self = State::from_lua(L);
+    // coroutines made by the update are its own business,
+    // and a yield inside a c call would be an error
+    if (L != self->_running || !lua_isyieldable(L))
+        return;
+    if (Profiler::clock::now() >= self->_deadline)
+        lua_yield(L, 0);
+}
+
+int lua::State::resume(
+    lua_State* co, int nargs, u64 budget_ns) {
+    auto start      = Profiler::clock::now();
+    lua_State* prev = this->_running;
+    this->_running  = co;
+    this->_deadline =
+        start + std::chrono::nanoseconds(budget_ns);
+
+    lua_sethook(co, State::_budget_hook, LUA_MASKCOUNT,
+        HOOK_COUNT);
+    int nres = 0;
+    int status =
+        lua_resume(co, this->_L.get(), nargs, &nres);
+    lua_sethook(co, nullptr, 0, 0);
+    this->_running = prev;
+
+    if (status == LUA_OK || status == LUA_YIELD)
+        lua_pop(co, nres);
+    if (this->_prof) {
+        auto& f = this->_prof->current();
+        f.coroutine_ns +=
+            Profiler::ns(Profiler::clock::now() - start);
+        f.coroutines += status == LUA_YIELD;
     }
+    return status;
+}
+
+size_t lua::State::dispatch_events() {
+    if (this->_events.pending() == 0)
+        return 0;
+    // every batch is delivered in a single call
+    this->count_lua_call();
+    return this->_events.dispatch(this->_L.get());
 }
 
 void lua::State::set_data(std::string key, Value val) {
     this->_data[key] = val;
 }
 
+// ----------[ingest]----------
+bool lua::State::push_data(
+    std::string_view key, Value val) {
+    bool ok = this->_inbox.try_emplace([&](Ingest& in) {
+        in.event = false;
+        in.key.assign(key);
+        in.value = std::move(val);
+    });
+    if (!ok)
+        this->_inbox_dropped.fetch_add(
+            1, std::memory_order_relaxed);
+    return ok;
+}
+
+bool lua::State::push_event(
+    std::string_view event, Value payload) {
+    bool ok = this->_inbox.try_emplace([&](Ingest& in) {
+        in.event = true;
+        in.key.assign(event);
+        in.value = std::move(payload);
+    });
+    if (!ok)
+        this->_inbox_dropped.fetch_add(
+            1, std::memory_order_relaxed);
+    return ok;
+}
+
+size_t lua::State::apply_pending() {
+    constexpr std::string_view prefix = "changed:";
+    this->_changed.clear();
+
+    size_t n = this->_inbox.drain([&](Ingest& in) {
+        if (in.event) {
+            this->post(in.key, std::move(in.value));
+            return;
+        }
+
+        Value& val = this->_data[in.key];
+        val        = std::move(in.value);
+
+        // only keys somebody listens to are told about
+        this->_changed_name.assign(prefix);
+        this->_changed_name += in.key;
+        EventId id =
+            this->_events.find(this->_changed_name);
+        if (!this->_events.has_handlers(id))
+            return;
+        for (auto& [seen, _] : this->_changed)
+            if (seen == id)
+                return;
+        // nodes of the map don't move while applying
+        this->_changed.emplace_back(id, &val);
+    });
+
+    // after the writes so handlers see the whole batch
+    for (auto& [id, val] : this->_changed)
+        this->_events.post(id, *val);
+    if (this->_prof)
+        this->_prof->current().ingested += n;
+    return n;
+}
+
 const lua::Value& lua::State::get_data(
     std::string key) const {
     auto& val = this->_data[key];
     return val;
 }
 
+// host functions are plain fields of the state table, the
+// closure is made here once instead of on every read. the
+// Fn lives in a node of _funcs so its address is stable
 void lua::State::set_function(
     std::string key, lua::State::Fn fn) {
-    this->_funcs.insert_or_assign(key, fn);
+    auto [it, _] =
+        this->_funcs.insert_or_assign(key, std::move(fn));
+
+    lua_State* L = this->_L.get();
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &_state_table_key);
+    lua_pushlstring(L, key.data(), key.size());
+    lua_pushlightuserdata(L, &it->second);
+    lua_pushcclosure(L, _state_exec, 1);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
 }
 
 lua::State::Fn& lua::State::get_func(std::string key) {
@@ -912,13 +1270,169 @@ bool lua::State::func_exitst(std::string key) {
     return this->_funcs.find(key) != this->_funcs.end();
 }
 
+void* lua::State::_alloc(
+    void* ud, void* ptr, size_t osize, size_t nsize) {
+    auto* state = static_cast<State*>(ud);
+    auto& pool  = state->_pool;
+    u64 allocs  = pool.stats().allocs;
+    u64 bytes   = pool.stats().bytes;
+    u64 sys     = pool.stats().sys_allocs;
+
+    void* out = pool.realloc(ptr, osize, nsize);
+    if (state->_prof) {
+        auto& cur      = state->_prof->current();
+        const auto& st = pool.stats();
+        cur.allocs += st.allocs - allocs;
+        cur.alloc_bytes += st.bytes - bytes;
+        cur.sys_allocs += st.sys_allocs - sys;
+        cur.mem_in_use = st.in_use;
+        cur.mem_peak   = std::max(cur.mem_peak, st.in_use);
+    }
+    return out;
+}
+
+int lua::State::_panic(lua_State* L) {
+    const char* msg = lua_tostring(L, -1);
+    std::cerr << "lua panic: " << (msg ? msg : "?") << '\n';
+    return 0;
+}
+
+void lua::State::set_gc(GcPolicy policy) {
+    lua_State* L = this->_L.get();
+    this->_gc    = policy;
+    if (policy.mode == GcMode::Generational)
+        lua_gc(L, LUA_GCGEN, 0, 0);
+    else
+        lua_gc(L, LUA_GCINC, 0, 0, 0);
+
+    if (policy.manual)
+        lua_gc(L, LUA_GCSTOP);
+    else
+        lua_gc(L, LUA_GCRESTART);
+    this->_gc_auto = false;
+
+    // changing the mode finishes the running cycle
+    this->_gc_cycle = false;
+    this->_gc_live  = this->_pool.stats().in_use;
+}
+
+bool lua::State::collect(u64 idle_ns) {
+    if (!this->_gc.manual)
+        return false;
+
+    bool gen   = this->_gc.mode == GcMode::Generational;
+    u64 growth = this->_gc.growth;
+    if (growth == 0)
+        growth = gen ? 20 : 100;
+
+    lua_State* L  = this->_L.get();
+    size_t live   = this->_gc_live;
+    size_t limit  = live + live / 100 * growth;
+    size_t in_use = this->_pool.stats().in_use;
+
+    // lua collects on its own again while this can't keep
+    // up, until memory is back under the limit
+    if (!this->_gc_auto && in_use > 2 * limit) {
+        lua_gc(L, LUA_GCRESTART);
+        this->_gc_auto = true;
+    }
+    else if (this->_gc_auto && in_use < limit) {
+        lua_gc(L, LUA_GCSTOP);
+        this->_gc_auto = false;
+    }
+
+    if (!this->_gc_cycle && in_use < limit)
+        return false;
+
+    using clock = Profiler::clock;
+    u64 budget  = this->_gc.budget_us * 1000;
+    budget      = std::min(budget, idle_ns);
+    auto start  = clock::now();
+
+    auto done = [&] {
+        this->_gc_cycle = false;
+        this->_gc_live  = this->_pool.stats().in_use;
+        return true;
+    };
+
+    this->_gc_cycle = true;
+    do {
+        // a generational step is a whole young collection
+        if (lua_gc(L, LUA_GCSTEP, 0) || gen)
+            return done();
+    } while (Profiler::ns(clock::now() - start) < budget);
+
+    // out of time and still over, the step pays for what
+    // was allocated past the limit
+    in_use = this->_pool.stats().in_use;
+    if (in_use > limit) {
+        size_t kb = std::min<size_t>(
+            (in_use - limit) / 1024, INT_MAX);
+        if (kb > 0 && lua_gc(L, LUA_GCSTEP, (int)kb))
+            return done();
+    }
+    return false;
+}
+
+// goes in front of the lua file searcher of require, finds
+// the module the same way but loads it through the cache.
+// when it is not found the lua searcher reports it
+static int _cached_searcher(lua_State* L) {
+    const char* name = luaL_checkstring(L, 1);
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "searchpath");
+    lua_pushstring(L, name);
+    lua_getfield(L, -3, "path");
+    lua_call(L, 2, 2);
+    if (lua_isnil(L, -2))
+        return 0;
+
+    const char* path = lua_tostring(L, -2);
+    auto& cache      = lua::State::from_lua(L)->cache();
+    if (cache.load(L, path) != LUA_OK)
+        return luaL_error(L,
+            "error loading module '%s' from file '%s':\n\t%s",
+            name, path, lua_tostring(L, -1));
+    lua_pushstring(L, path);
+    return 2;
+}
+
+static void _install_searcher(lua_State* L) {
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "searchers");
+    // the first one is package.preload
+    for (lua_Integer i = lua_rawlen(L, -1); i >= 2; --i) {
+        lua_rawgeti(L, -1, i);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_pushcfunction(L, _cached_searcher);
+    lua_rawseti(L, -2, 2);
+    lua_pop(L, 2);
+}
+
+lua::State* lua::State::from_lua(lua_State* L) {
+    return *static_cast<State**>(lua_getextraspace(L));
+}
+
 lua::State::State() {
     using namespace lua;
-    auto L_  = luaL_newstate();
+    auto L_ = lua_newstate(State::_alloc, this);
+    if (!L_)
+        LY_THROW("could not create the lua state");
     this->_L = std::shared_ptr<lua_State>(
         L_, State::LuaStateDeleter{});
+    lua_atpanic(L_, State::_panic);
+
+    *static_cast<State**>(lua_getextraspace(L_)) = this;
 
     luaL_openlibs(this->_L.get());
+    _install_searcher(this->_L.get());
+
+    this->_ev_keypress = this->_events.intern("keypress");
+    this->_events.set_coalesce(
+        this->_events.intern("resize"), true);
+    this->_events.set_coalesce(
+        this->_events.intern("mouse_move"), true);
     // luaL_requiref(L, "base", luaopen_base, true);
     // luaL_requiref(L, "math", luaopen_math, true);
     // luaL_requiref(L, "table", luaopen_table, true);
@@ -928,7 +1442,9 @@ lua::State::State() {
     init_buffer_metatable(this->_L.get());
     init_buffer_ref_metatable(this->_L.get());
     init_widget_metatable(this->_L.get());
+    lua::open_native_widgets(this->_L.get());
     init_state_table(*this, this->_L.get());
+    this->set_gc(this->_gc);
 };
 
 void lua::State::debug_print() const {
@@ -945,7 +1461,8 @@ void lua::State::debug_print() const {
 lua::LuaWidget lua::State::from_file(std::string file) {
     lua_State* L = this->_L.get();
 
-    if (luaL_dofile(L, file.c_str()) != LUA_OK) {
+    if (this->_cache.load(L, file) != LUA_OK ||
+        lua_pcall(L, 0, LUA_MULTRET, 0) != LUA_OK) {
         const char* err =
             lua_tostring(L, -1); // get error message
         std::string message =
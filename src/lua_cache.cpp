@@ -0,0 +1,222 @@
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ly/render/lua_cache.hpp>
+
+using namespace ly;
+using namespace ly::render;
+
+// magic, version, mtime, size and hash
+static constexpr size_t HEADER = 4 + 4 + 8 + 8 + 8;
+
+struct Header {
+    u64 mtime, size, hash;
+};
+
+static u64 _fnv(const char* data, size_t len) {
+    u64 h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (u8)data[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static bool _read(const std::string& path, std::string& out) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok) {
+        out.resize(st.st_size);
+        size_t done = 0;
+        while (done < out.size()) {
+            ssize_t n =
+                read(fd, out.data() + done, out.size() - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            done += n;
+        }
+        // it can shrink while reading
+        out.resize(done);
+    }
+    close(fd);
+    return ok;
+}
+
+static bool _parse(const std::string& data, Header& h) {
+    if (data.size() < HEADER ||
+        std::memcmp(data.data(), lua::cache::MAGIC, 4) != 0)
+        return false;
+
+    u32 version;
+    std::memcpy(&version, data.data() + 4, 4);
+    if (version != lua::cache::VERSION)
+        return false;
+    std::memcpy(&h.mtime, data.data() + 8, 8);
+    std::memcpy(&h.size, data.data() + 16, 8);
+    std::memcpy(&h.hash, data.data() + 24, 8);
+    return true;
+}
+
+static void _header(std::string& out, const Header& h) {
+    out.assign(lua::cache::MAGIC, 4);
+    out.append(reinterpret_cast<const char*>(
+                   &lua::cache::VERSION),
+        4);
+    out.append(reinterpret_cast<const char*>(&h.mtime), 8);
+    out.append(reinterpret_cast<const char*>(&h.size), 8);
+    out.append(reinterpret_cast<const char*>(&h.hash), 8);
+}
+
+static int _writer(
+    lua_State*, const void* p, size_t len, void* ud) {
+    static_cast<std::string*>(ud)->append(
+        static_cast<const char*>(p), len);
+    return 0;
+}
+
+// mkdir -p
+static void _make_dirs(const std::string& dir) {
+    for (size_t i = 1; i <= dir.size(); ++i) {
+        if (i == dir.size() || dir[i] == '/')
+            mkdir(dir.substr(0, i).c_str(), 0755);
+    }
+}
+
+std::string lua::ChunkCache::default_dir() {
+    if (const char* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/lui";
+    if (const char* home = getenv("HOME"); home && *home)
+        return std::string(home) + "/.cache/lui";
+    return "";
+}
+
+std::string lua::ChunkCache::_file_for(
+    const std::string& path) const {
+    // the same script reached through different relative
+    // paths shares its entry
+    char real[PATH_MAX];
+    std::string key = path;
+    if (realpath(path.c_str(), real))
+        key = real;
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.luac",
+        (unsigned long long)_fnv(key.data(), key.size()));
+    return this->_dir + "/" + name;
+}
+
+void lua::ChunkCache::_store(
+    const std::string& file, const std::string& data) {
+    std::string tmp =
+        file + ".tmp" + std::to_string((long)getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+        0644);
+    if (fd < 0 && errno == ENOENT) {
+        _make_dirs(this->_dir);
+        fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+            0644);
+    }
+    // the cache is only an optimization, failing to write
+    // it is not an error
+    if (fd < 0)
+        return;
+
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n =
+            write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    close(fd);
+
+    if (done != data.size() || rename(tmp.c_str(), file.c_str()))
+        unlink(tmp.c_str());
+}
+
+int lua::ChunkCache::load(
+    lua_State* L, const std::string& path) {
+    struct stat st;
+    if (this->_dir.empty() || stat(path.c_str(), &st) != 0)
+        return luaL_loadfilex(L, path.c_str(), nullptr);
+
+    Header now;
+    now.mtime = (u64)st.st_mtim.tv_sec * 1000000000ull +
+                st.st_mtim.tv_nsec;
+    now.size  = st.st_size;
+
+    std::string file  = this->_file_for(path);
+    std::string chunk = "@" + path;
+    std::string cached;
+    Header old;
+    bool valid = _read(file, cached) && _parse(cached, old);
+
+    auto load_cached = [&]() {
+        int status = luaL_loadbufferx(L, cached.data() + HEADER,
+            cached.size() - HEADER, chunk.c_str(), "b");
+        // made by another version of lua
+        if (status != LUA_OK)
+            lua_pop(L, 1);
+        return status == LUA_OK;
+    };
+
+    if (valid && old.mtime == now.mtime &&
+        old.size == now.size && load_cached()) {
+        this->_hits++;
+        return LUA_OK;
+    }
+
+    std::string src;
+    if (!_read(path, src))
+        return luaL_loadfilex(L, path.c_str(), nullptr);
+    now.hash = _fnv(src.data(), src.size());
+
+    // touched but not changed, only the mtime is updated
+    if (valid && old.hash == now.hash &&
+        old.size == src.size() && load_cached()) {
+        this->_hits++;
+        std::string header;
+        _header(header, now);
+        cached.replace(0, HEADER, header);
+        this->_store(file, cached);
+        return LUA_OK;
+    }
+
+    this->_misses++;
+    // like luaL_loadfile skip a BOM and a first line starting
+    // with #, the newline stays so line numbers don't move
+    size_t skip = 0;
+    if (src.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        skip = 3;
+    if (skip < src.size() && src[skip] == '#') {
+        size_t nl = src.find('\n', skip);
+        skip      = nl == std::string::npos ? src.size() : nl;
+    }
+
+    int status = luaL_loadbufferx(L, src.data() + skip,
+        src.size() - skip, chunk.c_str(), nullptr);
+    if (status != LUA_OK)
+        return status;
+
+    std::string out;
+    _header(out, now);
+    lua_dump(L, _writer, &out, 0);
+    this->_store(file, out);
+    return LUA_OK;
+}
@@ -0,0 +1,106 @@
+#include <ly/render/lua_pool.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace ly::render;
+
+lua::Pool::~Pool() {
+    for (void* chunk : this->_chunks) std::free(chunk);
+}
+
+void* lua::Pool::_small(size_t cls) {
+    auto& c = this->_classes[cls];
+    if (c.free) {
+        Free* f = c.free;
+        c.free  = f->next;
+        return f;
+    }
+
+    size_t size = (cls + 1) * STEP;
+    if (c.bump + size > c.end) {
+        // the tail of the old chunk is lost, it is smaller
+        // than a block
+        void* chunk = std::malloc(CHUNK);
+        if (!chunk)
+            return nullptr;
+        try {
+            this->_chunks.push_back(chunk);
+        } catch (const std::bad_alloc&) {
+            std::free(chunk);
+            return nullptr;
+        }
+        this->_stats.sys_allocs++;
+        this->_stats.reserved += CHUNK;
+        c.bump = static_cast<char*>(chunk);
+        c.end  = c.bump + CHUNK;
+    }
+
+    void* ptr = c.bump;
+    c.bump += size;
+    return ptr;
+}
+
+void* lua::Pool::_get(size_t size) {
+    if (size <= MAX_SMALL)
+        return this->_small(_class(size));
+    this->_stats.sys_allocs++;
+    return std::malloc(size);
+}
+
+void lua::Pool::_release(void* ptr, size_t size) {
+    if (size > MAX_SMALL) {
+        std::free(ptr);
+        return;
+    }
+    auto& c = this->_classes[_class(size)];
+    Free* f = static_cast<Free*>(ptr);
+    f->next = c.free;
+    c.free  = f;
+}
+
+void* lua::Pool::realloc(
+    void* ptr, size_t osize, size_t nsize) {
+    // osize is the type of the object when ptr is null
+    size_t old = ptr ? osize : 0;
+    if (nsize > old) {
+        this->_stats.allocs++;
+        this->_stats.bytes += nsize - old;
+    }
+
+    void* out = nullptr;
+    if (nsize == 0) {
+        // lua also frees empty arrays, which are null
+        if (ptr)
+            this->_release(ptr, old);
+    }
+    else if (!ptr) {
+        out = this->_get(nsize);
+    }
+    else if (old <= MAX_SMALL && nsize <= MAX_SMALL &&
+             _class(old) == _class(nsize)) {
+        out = ptr;
+    }
+    else if (old > MAX_SMALL && nsize > MAX_SMALL) {
+        this->_stats.sys_allocs++;
+        out = std::realloc(ptr, nsize);
+    }
+    else {
+        out = this->_get(nsize);
+        if (out) {
+            std::memcpy(out, ptr, std::min(old, nsize));
+            this->_release(ptr, old);
+        }
+    }
+
+    if (nsize != 0 && !out)
+        return nullptr;
+
+    this->_stats.in_use += nsize;
+    this->_stats.in_use -= old;
+    this->_stats.peak =
+        std::max(this->_stats.peak, this->_stats.in_use);
+    return out;
+}
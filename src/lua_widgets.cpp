@@ -0,0 +1,173 @@
+#include <ly/render/log_view.hpp>
+#include <ly/render/lua_bindings.hpp>
+#include <ly/render/lua_class.hpp>
+#include <ly/render/widgets.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+using namespace ly::render;
+using namespace ly::render::widgets;
+
+template <typename W>
+using Native = lua::Class<W, Widget>;
+
+// ----------[properties]----------
+// 1 based, nil when nothing is selected
+static int _list_selected_get(lua_State* L) {
+    auto& sel = Native<List>::test(L, 1)->selected;
+    if (sel)
+        lua_pushinteger(L, *sel + 1);
+    else
+        lua_pushnil(L);
+    return 1;
+}
+
+// past the end is the last item. with no items yet it is
+// kept as is, the fields of native.list{} come in any order
+static int _list_selected_set(lua_State* L) {
+    auto& list = *Native<List>::test(L, 1);
+    auto sel = lua::check<std::optional<lua_Integer>>(L, 3);
+    if (sel && *sel >= 1) {
+        size_t at = *sel - 1;
+        if (!list.items.empty())
+            at = std::min(at, list.items.size() - 1);
+        list.selected = at;
+    }
+    else {
+        list.selected.reset();
+    }
+    return 0;
+}
+
+// the userdata is kept as the user value so the same one
+// is given back
+static int _box_child_get(lua_State* L) {
+    lua_getiuservalue(L, 1, 1);
+    return 1;
+}
+
+static int _box_child_set(lua_State* L) {
+    auto& box = *Native<Box>::test(L, 1);
+    if (lua_isnoneornil(L, 3)) {
+        box.child.reset();
+    }
+    else {
+        auto* child = lua::to_base<Widget>(L, 3);
+        luaL_argcheck(L, child, 3, "not a native widget");
+        // a box inside itself would never stop rendering
+        for (auto* at = child->get(); at;) {
+            if (at == &box)
+                return luaL_argerror(
+                    L, 3, "box would contain itself");
+            auto* inner = dynamic_cast<Box*>(at);
+            at = inner ? inner->child.get() : nullptr;
+        }
+        box.child = *child;
+    }
+    lua_pushvalue(L, 3);
+    lua_setiuservalue(L, 1, 1);
+    return 0;
+}
+
+// params: log, text, color (optional)
+static int _log_push(lua_State* L) {
+    auto* log = Native<LogView>::test(L, 1);
+    if (!log)
+        return luaL_typeerror(L, 1, "native.LogView");
+    auto text = lua::check<std::string_view>(L, 2);
+
+    ConsoleColor color = ConsoleColor::WHITE;
+    if (!lua_isnoneornil(L, 3))
+        color = lua::check<ConsoleColor>(L, 3);
+    lua_pushboolean(L, log->push(text, color));
+    return 1;
+}
+
+// ----------[widgets]----------
+// the constructors in `native`
+struct Ctor {
+    const char* name;
+    lua_CFunction make;
+};
+
+static const Ctor _ctors[] = {
+    {"label", Native<Label>::constructor()},
+    {"progress", Native<ProgressBar>::constructor()},
+    {"gauge", Native<Gauge>::constructor()},
+    {"list", Native<List>::constructor()},
+    {"table", Native<Table>::constructor()},
+    {"box", Native<Box>::constructor()},
+    {"log", Native<LogView>::constructor()},
+};
+
+static void _open_classes(lua_State* L) {
+    Native<Label>("native.Label")
+        .field<&Label::text>("text")
+        .field<&Label::align>("align")
+        .field<&Label::truncate>("truncate")
+        .field<&Label::ellipsis>("ellipsis")
+        .field<&Label::color>("color")
+        .open(L);
+
+    Native<ProgressBar>("native.ProgressBar")
+        .field<&ProgressBar::value>("value")
+        .field<&ProgressBar::show_number>("show_number")
+        .field<&ProgressBar::color>("color")
+        .open(L);
+
+    Native<Gauge>("native.Gauge")
+        .field<&Gauge::value>("value")
+        .field<&Gauge::label>("label")
+        .field<&Gauge::color>("color")
+        .open(L);
+
+    Native<List>("native.List")
+        .field<&List::items>("items")
+        .property("selected", _list_selected_get,
+            _list_selected_set)
+        .field<&List::color>("color")
+        .method<&List::move>("move")
+        .open(L);
+
+    // rows is an array of rows, each an array of strings
+    Native<Table>("native.Table")
+        .field<&Table::headers>("headers")
+        .field<&Table::rows>("rows")
+        .field<&Table::color>("color")
+        .method<&Table::add_row>("add_row")
+        .method<&Table::clear>("clear")
+        .open(L);
+
+    Native<Box>("native.Box")
+        .field<&Box::title>("title")
+        .property("child", _box_child_get, _box_child_set)
+        .field<&Box::color>("color")
+        .open(L);
+
+    Native<LogView>("native.LogView")
+        .method("push", _log_push)
+        .method<&LogView::scroll>("scroll")
+        .method<&LogView::follow>("follow")
+        .method<&LogView::following>("following")
+        .method<&LogView::size>("size")
+        .method<&LogView::dropped>("dropped")
+        .open(L);
+}
+
+widgets::Widget* lua::to_native_widget(lua_State* L, int index) {
+    auto* ptr = lua::to_base<Widget>(L, index);
+    return ptr ? ptr->get() : nullptr;
+}
+
+void lua::open_native_widgets(lua_State* L) {
+    _open_classes(L);
+
+    lua_createtable(L, 0, std::size(_ctors));
+    for (const auto& ctor : _ctors) {
+        lua_pushcfunction(L, ctor.make);
+        lua_setfield(L, -2, ctor.name);
+    }
+    lua_setglobal(L, "native");
+}
@@ -1,108 +1,193 @@
-#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <lua.hpp>
 
-#include <thread>
+#include <memory>
+#include <optional>
+#include <string>
 
 #include <termios.h>
 #include <unistd.h>
 
 #include <ly/render/buffer.hpp>
 #include <ly/render/lua_bindings.hpp>
+#include <ly/render/pacer.hpp>
+#include <ly/render/record.hpp>
+#include <ly/render/sink.hpp>
 #include <ly/render/utils.hpp>
 #include <ly/render/widgets.hpp>
 #include <ly/render/window.hpp>
 
 int main(int argc, char* argv[]) {
-    using namespace std::chrono;
     using namespace ly;
 
-    constexpr auto tick_duration = 20ms;
-
     render::Window win;
+    std::unique_ptr<render::FdSink> tty;
+    std::unique_ptr<render::FrameRecorder> rec;
+    render::lua::GcPolicy gc;
+    std::optional<std::string> cache_dir;
+    render::FramePacer::Config pacing;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        // render somewhere other than the controlling
+        // terminal
+        if (arg == "--tty") {
+            tty = std::make_unique<render::FdSink>(
+                std::string(argv[i + 1]));
+            win.set_sink(*tty);
+        }
+        // append the damage of every frame to a file
+        else if (arg == "--record") {
+            rec = std::make_unique<render::FrameRecorder>(
+                std::string(argv[i + 1]));
+            win.set_recorder(rec.get());
+        }
+        // incremental or generational
+        else if (arg == "--gc") {
+            using render::lua::GcMode;
+            gc.mode = std::string(argv[i + 1]) == "generational"
+                          ? GcMode::Generational
+                          : GcMode::Incremental;
+        }
+        // where compiled scripts are kept, empty to not
+        // keep them
+        else if (arg == "--cache") {
+            cache_dir = argv[i + 1];
+        }
+        // most microseconds spent collecting in a frame
+        else if (arg == "--gc-budget") {
+            gc.budget_us =
+                std::strtoull(argv[i + 1], nullptr, 10);
+        }
+        // frames per second, input and updates run at it
+        else if (arg == "--fps") {
+            pacing.update_hz =
+                std::strtoul(argv[i + 1], nullptr, 10);
+        }
+        // draws per second when there is time for them
+        else if (arg == "--render-fps") {
+            pacing.render_hz =
+                std::strtoul(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    render::Profiler prof;
+    render::widgets::StatsOverlay overlay(prof);
+    win.set_profiler(&prof);
+    render::FramePacer pacer(pacing);
+    pacer.set_profiler(&prof);
 
     ly::render::lua::State state;
+    state.set_profiler(&prof);
+    state.set_gc(gc);
+    if (cache_dir)
+        state.cache().set_dir(*cache_dir);
     state.set_function("set_color", [&](lua_State* L) {
         std::string type = lua_tostring(L, 1);
 
         render::ConsoleColor& color = (type == "fg")
                                           ? win.default_fc
                                           : win.default_bc;
-        lua_getfield(L, 2, "type");
-        lua_getfield(L, 2, "r");
-        lua_getfield(L, 2, "g");
-        lua_getfield(L, 2, "b");
-
-        std::string ty = lua_tostring(L, -4);
-        int r          = lua_tointeger(L, -3);
-        int g          = lua_tointeger(L, -2);
-        int b          = lua_tointeger(L, -1);
-        lua_pop(L, 4);
-
-        if (ty == "bit") {
-            r     = (r & 1) << 0;
-            g     = (g & 1) << 1;
-            b     = (b & 1) << 2;
-            color = render::ConsoleColor(r | g | b);
-        }
-        else if (ty == "8bit") {
-            color =
-                render::ConsoleColor(render::Color<ly::u8>(
-                    r & 0xff, g & 0xff, b & 0xff));
-        }
-
+        render::lua::to_color(L, 2, color);
         return 0;
     });
 
     auto widget = state.from_file("init.lua");
 
-    float fps   = 0;
     size_t tick = 0;
-    char cbuf   = 0;
     auto val    = render::lua::Value::float_val(10.);
+    char cbuf[64];
     ly::render::set_raw_mode();
-    ly::render::enter_alternate_screen();
+    ly::render::watch_resize();
+    ly::render::enter_alternate_screen(win.sink());
+
+    // frames are shown at once when the terminal can do it
+    std::string typed;
+    if (render::query_sync_output(win.sink(), typed)) {
+        auto caps = win.encoder().caps();
+        caps.sync = true;
+        win.encoder().set_caps(caps);
+    }
+    // keys pressed while waiting for the answer
+    for (char c : typed) state.press(c);
 
     win.init_buffer();
     while (!state.should_exit()) {
-        render::reset_cursor();
-        auto t_start = high_resolution_clock::now();
+        prof.begin_frame();
+        // input is handled every frame, drawing is what
+        // gives when there is no time
+        bool draw = pacer.begin();
 
         state.set_data("tick",
             render::lua::Value::integer((int64_t)tick));
-        state.set_data("fps",
-            render::lua::Value::float_val((double)fps));
-
-        printf("\e[0;0H"); // return cursor to 0,0
-        fflush(stdout);
-
-        if (read(STDIN_FILENO, &cbuf, 1) > 0) {
-            state.press(cbuf);
+        state.set_data(
+            "fps", render::lua::Value::float_val(prof.fps()));
+
+        {
+            render::Profiler::Scope _t(
+                &prof, render::Phase::Input);
+            // a burst of SIGWINCH is handled once
+            if (render::take_resize() && win.resize()) {
+                using render::lua::Value;
+                auto size      = Value::map();
+                size["width"]  = Value::integer(
+                    (int64_t)win.width());
+                size["height"] = Value::integer(
+                    (int64_t)win.height());
+                state.post("resize", size);
+            }
+
+            // drain everything typed since the last frame
+            // and deliver it in one go
+            ssize_t n;
+            while ((n = read(STDIN_FILENO, cbuf,
+                        sizeof(cbuf))) > 0) {
+                for (ssize_t i = 0; i < n; ++i)
+                    state.press(cbuf[i]);
+            }
+            // pushed by other threads since the last frame
+            state.apply_pending();
+            state.dispatch_events();
         }
 
-        widget.update();
-        win.get_buf().render_widget(widget);
-        win.render();
-
-        // tick rate calc
-        auto t_now = high_resolution_clock::now();
-        auto delta = t_now - t_start;
+        {
+            render::Profiler::Scope _t(
+                &prof, render::Phase::Update);
+            widget.update();
+        }
 
-        // wait for end of tick
-        if (delta < tick_duration)
-            std::this_thread::sleep_for(
-                tick_duration - delta);
+        if (draw) {
+            render::Profiler::Scope _t(
+                &prof, render::Phase::Render);
+            win.get_buf().render_widget(widget);
+
+            overlay.visible =
+                state.get_data("show_stats").as_boolean();
+            if (overlay.visible &&
+                win.width() >= overlay.WIDTH) {
+                auto sub = win.get_subbuf(
+                    win.width() - overlay.WIDTH, 0,
+                    overlay.WIDTH, overlay.HEIGHT);
+                sub.render_widget(overlay);
+            }
+        }
+        if (draw)
+            win.render();
+        pacer.end();
+
+        {
+            render::Profiler::Scope _t(
+                &prof, render::Phase::Gc);
+            // collect in what is left of the tick
+            state.collect(pacer.idle_ns());
+        }
+        prof.end_frame();
 
-        // Optional: print elapsed time for debugging
-        auto t_end = high_resolution_clock::now();
-        auto total_elapsed =
-            duration_cast<milliseconds>(t_end - t_start);
-        fps = 1000.0 / total_elapsed.count();
+        pacer.wait();
         tick++;
     }
 
     ly::render::unset_raw_mode();
-    ly::render::leave_alternate_screen();
+    ly::render::leave_alternate_screen(win.sink());
     return 0;
 }
@@ -0,0 +1,121 @@
+#include <ly/render/pacer.hpp>
+
+#include <algorithm>
+#include <thread>
+
+using namespace ly;
+using namespace ly::render;
+
+FramePacer::FramePacer() : FramePacer(Config{}) {}
+
+FramePacer::FramePacer(Config config) : _cfg(config) {
+    u32 update = std::max<u32>(this->_cfg.update_hz, 1);
+    u32 render = update;
+    if (this->_cfg.render_hz)
+        render = std::min(this->_cfg.render_hz, update);
+    u32 lowest = std::clamp<u32>(
+        this->_cfg.min_render_hz, 1, render);
+
+    auto tick   = std::chrono::nanoseconds(
+        1'000'000'000 / update);
+    this->_tick = std::chrono::duration_cast<
+        clock::duration>(tick);
+
+    this->_base  = (update + render - 1) / render;
+    this->_max   = std::max(this->_base, update / lowest);
+    this->_every = this->_base;
+}
+
+u32 FramePacer::_fit() const {
+    u64 tick = Profiler::ns(this->_tick);
+    // a draw and every-1 frames that don't, in every ticks
+    u32 every = this->_base;
+    while (every < this->_max &&
+           this->_draw_ns + (every - 1) * this->_nodraw_ns >
+               every * tick)
+        every++;
+    return every;
+}
+
+bool FramePacer::begin() {
+    auto now = clock::now();
+    if (!this->_started) {
+        this->_next    = now;
+        this->_started = true;
+    }
+
+    u64 late = 0;
+    if (now > this->_next)
+        late = Profiler::ns(now - this->_next);
+    // too far behind, the lost time is given up
+    if (late > Profiler::ns(this->_tick))
+        this->_next = now;
+    this->_start = now;
+    this->_next += this->_tick;
+
+    bool due = ++this->_since_draw >= this->_every;
+    // a late frame gives its draw to the next one, once
+    bool postponed = due &&
+                     this->_since_draw == this->_every &&
+                     late > Profiler::ns(this->_tick) / 2;
+    this->_draw = due && !postponed;
+    if (this->_draw)
+        this->_since_draw = 0;
+
+    if (this->_prof) {
+        auto& f   = this->_prof->current();
+        f.late_ns = late;
+        // one that would have drawn at the configured rate
+        bool base = this->_since_draw % this->_base == 0;
+        f.skipped = !this->_draw && (postponed || base);
+    }
+    return this->_draw;
+}
+
+void FramePacer::end() {
+    u64 busy = Profiler::ns(clock::now() - this->_start);
+    u64& avg = this->_draw ? this->_draw_ns
+                           : this->_nodraw_ns;
+    avg      = avg ? (avg * 7 + busy) / 8 : busy;
+
+    u32 fit = this->_fit();
+    if (fit > this->_every) {
+        this->_under = 0;
+        if (++this->_over >= this->_cfg.overload_frames) {
+            this->_every = fit;
+            this->_over  = 0;
+        }
+    }
+    else if (fit < this->_every) {
+        this->_over = 0;
+        u32 frames = 4 * this->_cfg.overload_frames;
+        if (++this->_under >= frames) {
+            this->_every = fit;
+            this->_under = 0;
+        }
+    }
+    else {
+        this->_over = this->_under = 0;
+    }
+
+    if (this->_prof) {
+        auto& f     = this->_prof->current();
+        f.render_hz = this->render_hz();
+        f.overload  = this->overloaded();
+    }
+}
+
+u64 FramePacer::idle_ns() const {
+    auto now = clock::now();
+    if (now >= this->_next)
+        return 0;
+    return Profiler::ns(this->_next - now);
+}
+
+void FramePacer::wait() const {
+    std::this_thread::sleep_until(this->_next);
+}
+
+f64 FramePacer::render_hz() const {
+    return 1e9 / Profiler::ns(this->_tick) / this->_every;
+}
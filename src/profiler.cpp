@@ -0,0 +1,125 @@
+#include <ly/exceptions.hpp>
+#include <ly/render/profiler.hpp>
+
+#include <algorithm>
+
+using namespace ly;
+using namespace ly::render;
+
+const char* render::phase_name(Phase phase) {
+    switch (phase) {
+    case Phase::Input:
+        return "input";
+    case Phase::Update:
+        return "update";
+    case Phase::Render:
+        return "render";
+    case Phase::Diff:
+        return "diff";
+    case Phase::Encode:
+        return "encode";
+    case Phase::Write:
+        return "write";
+    case Phase::Gc:
+        return "gc";
+    default:
+        return "unknown";
+    }
+}
+
+void Profiler::begin_frame() {
+    // memory is carried over, a frame that allocates
+    // nothing still holds it
+    u64 mem = this->_cur.mem_in_use;
+
+    this->_cur            = {};
+    this->_start          = clock::now();
+    this->_cur.mem_in_use = mem;
+    this->_cur.mem_peak   = mem;
+    if (this->_started) {
+        this->_cur.interval_ns =
+            ns(this->_start - this->_last_start);
+    }
+    this->_last_start = this->_start;
+    this->_started    = true;
+}
+
+void Profiler::end_frame() {
+    this->_cur.busy_ns = ns(clock::now() - this->_start);
+
+    this->_ring[this->_head] = this->_cur;
+    this->_head              = (this->_head + 1) % HISTORY;
+    if (this->_size < HISTORY)
+        this->_size++;
+}
+
+const FrameStats& Profiler::get(size_t i) const {
+    if (i >= this->_size)
+        LY_THROW("frame " << i << " is not in the history");
+    return this->_ring[(this->_head + HISTORY - 1 - i) % HISTORY];
+}
+
+FrameStats Profiler::average() const {
+    FrameStats avg = {};
+    if (this->_size == 0)
+        return avg;
+
+    for (size_t i = 0; i < this->_size; ++i) {
+        const auto& f = this->get(i);
+        for (size_t p = 0; p < PHASE_COUNT; ++p)
+            avg.phase_ns[p] += f.phase_ns[p];
+        avg.busy_ns += f.busy_ns;
+        avg.interval_ns += f.interval_ns;
+        avg.cells_changed += f.cells_changed;
+        avg.bytes_written += f.bytes_written;
+        avg.text_hits += f.text_hits;
+        avg.text_misses += f.text_misses;
+        avg.lua_calls += f.lua_calls;
+        avg.ingested += f.ingested;
+        avg.coroutines += f.coroutines;
+        avg.coroutine_ns += f.coroutine_ns;
+        avg.late_ns += f.late_ns;
+        avg.skipped += f.skipped;
+        avg.render_hz += f.render_hz;
+        avg.overload += f.overload;
+        avg.allocs += f.allocs;
+        avg.alloc_bytes += f.alloc_bytes;
+        avg.sys_allocs += f.sys_allocs;
+        avg.mem_in_use += f.mem_in_use;
+        avg.mem_peak = std::max(avg.mem_peak, f.mem_peak);
+    }
+
+    for (auto& p : avg.phase_ns) p /= this->_size;
+    avg.busy_ns /= this->_size;
+    avg.interval_ns /= this->_size;
+    avg.cells_changed /= this->_size;
+    avg.bytes_written /= this->_size;
+    avg.text_hits /= this->_size;
+    avg.text_misses /= this->_size;
+    avg.lua_calls /= this->_size;
+    avg.ingested /= this->_size;
+    avg.coroutines /= this->_size;
+    avg.coroutine_ns /= this->_size;
+    avg.late_ns /= this->_size;
+    avg.render_hz /= this->_size;
+    avg.allocs /= this->_size;
+    avg.alloc_bytes /= this->_size;
+    avg.sys_allocs /= this->_size;
+    avg.mem_in_use /= this->_size;
+    return avg;
+}
+
+f64 Profiler::fps() const {
+    u64 total = 0;
+    size_t n  = 0;
+    for (size_t i = 0; i < this->_size; ++i) {
+        // the first frame has no interval
+        if (this->get(i).interval_ns == 0)
+            continue;
+        total += this->get(i).interval_ns;
+        n++;
+    }
+    if (total == 0)
+        return 0.;
+    return 1e9 * n / total;
+}
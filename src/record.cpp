@@ -0,0 +1,241 @@
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ly/exceptions.hpp>
+#include <ly/render/record.hpp>
+
+#include <sstream>
+
+using namespace ly;
+using namespace ly::render;
+
+template <typename T>
+static void _put(std::string& out, T val) {
+    out.append(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+template <typename T>
+static T _get(const u8*& p) {
+    T val;
+    std::memcpy(&val, p, sizeof(T));
+    p += sizeof(T);
+    return val;
+}
+
+// a frame cut short would make every later one unreadable
+static void _write_all(
+    int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            LY_THROW("write failed: " << strerror(errno));
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+// ----------[recorder]----------
+FrameRecorder::FrameRecorder(const std::string& path)
+    : _start(std::chrono::steady_clock::now()) {
+    this->_fd =
+        open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (this->_fd < 0)
+        LY_THROW("could not open " << path << ": "
+                                   << strerror(errno));
+
+    struct stat st;
+    if (fstat(this->_fd, &st) < 0) {
+        close(this->_fd);
+        LY_THROW("could not stat " << path << ": "
+                                   << strerror(errno));
+    }
+
+    // frames are only added to a recording of this version
+    if (st.st_size > 0) {
+        u8 header[record::HEADER_SIZE];
+        ssize_t n   = pread(this->_fd, header, sizeof(header), 0);
+        const u8* p = header + 4;
+        if (n != (ssize_t)sizeof(header) ||
+            std::memcmp(header, record::MAGIC, 4) != 0 ||
+            _get<u32>(p) != record::VERSION) {
+            close(this->_fd);
+            LY_THROW(path << " is not a recording of version "
+                          << record::VERSION);
+        }
+        return;
+    }
+
+    std::string header(record::MAGIC, 4);
+    _put<u32>(header, record::VERSION);
+    try {
+        _write_all(this->_fd, header.data(), header.size());
+    } catch (...) {
+        close(this->_fd);
+        throw;
+    }
+}
+
+FrameRecorder::~FrameRecorder() {
+    close(this->_fd);
+}
+
+void FrameRecorder::record(const std::vector<Run>& damage,
+    const Buffer& buf, const std::optional<Scroll>& scroll) {
+    auto now = std::chrono::steady_clock::now() - this->_start;
+
+    const std::vector<Run>* runs = &damage;
+    Scroll moved = scroll.value_or(Scroll{0, 0, 0});
+    if (buf.width() != this->_width ||
+        buf.height() != this->_height) {
+        this->_width  = buf.width();
+        this->_height = buf.height();
+        this->_full.clear();
+        for (size_t y = 0; y < this->_height; ++y)
+            this->_full.push_back({0, y, this->_width});
+        runs  = &this->_full;
+        moved = {0, 0, 0};
+    }
+
+    auto& out = this->_buf;
+    out.clear();
+    // size is filled at the end
+    _put<u32>(out, 0);
+    _put<u32>(out, runs->size());
+    _put<u64>(out,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now)
+            .count());
+    _put<u16>(out, buf.width());
+    _put<u16>(out, buf.height());
+    _put<u16>(out, moved.top);
+    _put<u16>(out, moved.bottom);
+    _put<i16>(out, moved.n);
+
+    for (const auto& run : *runs) {
+        _put<u16>(out, run.x);
+        _put<u16>(out, run.y);
+        _put<u16>(out, run.len);
+
+        for (size_t i = 0; i < run.len; ++i) {
+            const auto& u = buf.get(run.x + i, run.y);
+            size_t len    = std::min<size_t>(u.data.size(), 255);
+            _put<u32>(out, u.fc.pack());
+            _put<u32>(out, u.bc.pack());
+            _put<u8>(out, u.attr);
+            _put<u8>(out, len);
+            out.append(u.data.data(), len);
+        }
+    }
+
+    u32 size = out.size() - sizeof(u32);
+    std::memcpy(out.data(), &size, sizeof(u32));
+
+    // one write per frame keeps the file appendable from
+    // several processes, a short one is finished
+    _write_all(this->_fd, out.data(), out.size());
+}
+
+// ----------[replay]----------
+Recording::Recording(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        LY_THROW("could not open " << path << ": "
+                                   << strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 ||
+        (size_t)st.st_size < record::HEADER_SIZE) {
+        close(fd);
+        LY_THROW(path << " is not a recording");
+    }
+
+    this->_size = st.st_size;
+    void* data =
+        mmap(nullptr, this->_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        LY_THROW("mmap failed: " << strerror(errno));
+
+    this->_data = static_cast<const u8*>(data);
+    madvise(data, this->_size, MADV_SEQUENTIAL);
+
+    const u8* p = this->_data + 4;
+    if (std::memcmp(this->_data, record::MAGIC, 4) != 0 ||
+        _get<u32>(p) != record::VERSION) {
+        munmap(data, this->_size);
+        LY_THROW(path << " is not a recording");
+    }
+}
+
+Recording::~Recording() {
+    munmap(const_cast<u8*>(this->_data), this->_size);
+}
+
+bool Recording::next(Frame& frame) {
+    if (this->_pos + record::FRAME_SIZE > this->_size)
+        return false;
+
+    const u8* p = this->_data + this->_pos;
+    u32 size    = _get<u32>(p);
+    if (size < record::FRAME_SIZE - sizeof(u32) ||
+        this->_pos + sizeof(u32) + size > this->_size)
+        return false;
+
+    frame.runs          = _get<u32>(p);
+    frame.time_ns       = _get<u64>(p);
+    frame.width         = _get<u16>(p);
+    frame.height        = _get<u16>(p);
+    frame.scroll_top    = _get<u16>(p);
+    frame.scroll_bottom = _get<u16>(p);
+    frame.scroll        = _get<i16>(p);
+    frame.data          = p;
+    frame.end =
+        this->_data + this->_pos + sizeof(u32) + size;
+
+    this->_pos += sizeof(u32) + size;
+    return true;
+}
+
+void Recording::Frame::apply(Buffer& buf) const {
+    if (this->scroll != 0)
+        buf.shift_rows(
+            this->scroll_top, this->scroll_bottom, this->scroll);
+
+    const u8* p = this->data;
+    for (size_t r = 0; r < this->runs; ++r) {
+        if (p + record::RUN_SIZE > this->end)
+            LY_THROW("corrupted frame");
+        size_t x   = _get<u16>(p);
+        size_t y   = _get<u16>(p);
+        size_t len = _get<u16>(p);
+
+        for (size_t i = 0; i < len; ++i) {
+            if (p + 10 > this->end)
+                LY_THROW("corrupted frame");
+            auto fc    = ConsoleColor::unpack(_get<u32>(p));
+            auto bc    = ConsoleColor::unpack(_get<u32>(p));
+            u8 attr    = _get<u8>(p);
+            size_t glen = _get<u8>(p);
+            if (p + glen > this->end)
+                LY_THROW("corrupted frame");
+
+            if (x + i < buf.width() && y < buf.height()) {
+                auto& u = buf.get(x + i, y);
+                u.fc    = fc;
+                u.bc    = bc;
+                u.attr  = attr;
+                u.data.assign(
+                    reinterpret_cast<const char*>(p), glen);
+            }
+            p += glen;
+        }
+    }
+}
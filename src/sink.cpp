@@ -0,0 +1,116 @@
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <ly/exceptions.hpp>
+#include <ly/render/sink.hpp>
+
+#include <sstream>
+
+using namespace ly;
+using namespace ly::render;
+
+// bigger writes skip the buffer when it is empty
+static constexpr size_t DIRECT_WRITE = 4096;
+
+// ----------[fd]----------
+FdSink::FdSink(int fd, bool owned, int input)
+    : _fd(fd), _owned(owned), _input(input) {}
+
+FdSink::FdSink(const std::string& path)
+    : _owned(true), _input(-1) {
+    this->_fd = open(path.c_str(), O_WRONLY | O_NOCTTY);
+    if (this->_fd < 0)
+        LY_THROW("could not open " << path << ": "
+                                   << strerror(errno));
+}
+
+FdSink::~FdSink() {
+    // the terminal may be gone by now
+    try {
+        this->flush();
+    } catch (const RuntimeError&) {
+    }
+    if (this->_owned)
+        close(this->_fd);
+}
+
+void FdSink::_write_all(const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(this->_fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd p = {this->_fd, POLLOUT, 0};
+                poll(&p, 1, -1);
+                continue;
+            }
+            LY_THROW("write failed: " << strerror(errno));
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void FdSink::write(const char* data, size_t len) {
+    this->_bytes += len;
+    if (this->_buf.empty() && len >= DIRECT_WRITE) {
+        this->_write_all(data, len);
+        return;
+    }
+    this->_buf.append(data, len);
+}
+
+void FdSink::flush() {
+    if (this->_buf.empty())
+        return;
+    this->_write_all(this->_buf.data(), this->_buf.size());
+    this->_buf.clear();
+}
+
+bool FdSink::size(size_t& width, size_t& height) const {
+    struct winsize w;
+    if (ioctl(this->_fd, TIOCGWINSZ, &w) < 0)
+        return false;
+    width  = w.ws_col;
+    height = w.ws_row;
+    return true;
+}
+
+// ----------[memory]----------
+void MemorySink::write(const char* data, size_t len) {
+    this->_bytes += len;
+    this->_data.append(data, len);
+}
+
+// ----------[file]----------
+FileSink::FileSink(const std::string& path) {
+    this->_file = fopen(path.c_str(), "ab");
+    if (!this->_file)
+        LY_THROW("could not open " << path << ": "
+                                   << strerror(errno));
+}
+
+FileSink::~FileSink() {
+    fclose(this->_file);
+}
+
+void FileSink::write(const char* data, size_t len) {
+    this->_bytes += len;
+    if (fwrite(data, 1, len, this->_file) != len)
+        LY_THROW("write failed: " << strerror(errno));
+}
+
+void FileSink::flush() {
+    fflush(this->_file);
+}
+
+TerminalSink& ly::render::stdout_sink() {
+    static FdSink sink(STDOUT_FILENO, false, STDIN_FILENO);
+    return sink;
+}
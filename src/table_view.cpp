@@ -0,0 +1,254 @@
+#include <ly/render/table_view.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+
+using namespace ly;
+using namespace ly::render;
+using namespace ly::render::widgets;
+
+TableView::TableView(std::shared_ptr<RowProvider> rows)
+    : _rows(std::move(rows)) {}
+
+TableView::~TableView() { this->_stop_sort(); }
+
+void TableView::set_rows(
+    std::shared_ptr<RowProvider> rows) {
+    this->_stop_sort();
+    this->_rows    = std::move(rows);
+    this->_offset  = 0;
+    this->_sampled = 0;
+    this->_widths.clear();
+    this->_sort.reset();
+    this->_done.reset();
+    this->selected.reset();
+}
+
+void TableView::scroll(i64 delta) {
+    i64 to        = (i64)this->_offset + delta;
+    this->_offset = to < 0 ? 0 : to;
+}
+
+void TableView::move(i64 delta) {
+    size_t n = this->_rows ? this->_rows->rows() : 0;
+    if (n == 0) {
+        this->selected.reset();
+        return;
+    }
+
+    i64 to = 0;
+    if (this->selected)
+        to = (i64)*this->selected + delta;
+    this->selected = std::clamp<i64>(to, 0, n - 1);
+
+    // lines are rows, or the header and the rows
+    size_t line = *this->selected + !this->sticky_header;
+    size_t page = this->_page;
+    if (line < this->_offset)
+        this->_offset = line;
+    else if (page && line >= this->_offset + page)
+        this->_offset = line - page + 1;
+    if (!this->sticky_header && *this->selected == 0)
+        this->_offset = 0;
+}
+
+// ----------[sorting]----------
+// thrown from the comparison to get out of std::sort
+struct SortCancelled {};
+
+// numbers go first, by value, then text
+struct SortKey {
+    f64 num;
+    bool is_num;
+    std::string text;
+};
+
+static bool _less(const SortKey& a, const SortKey& b) {
+    if (a.is_num != b.is_num)
+        return a.is_num;
+    if (a.is_num)
+        return a.num < b.num;
+    return a.text < b.text;
+}
+
+void TableView::_stop_sort() {
+    this->_cancel = true;
+    if (this->_sorter.joinable())
+        this->_sorter.join();
+    this->_cancel  = false;
+    this->_sorting = false;
+}
+
+void TableView::sort_by(size_t col, bool descending) {
+    this->_stop_sort();
+    if (!this->_rows || col >= this->_rows->columns())
+        return;
+
+    auto rows      = this->_rows;
+    this->_sorting = true;
+    this->_sorter  = std::thread(
+        &TableView::_run_sort, this, rows, col, descending);
+}
+
+void TableView::unsort() {
+    this->_stop_sort();
+    std::lock_guard<std::mutex> guard(this->_lock);
+    this->_sort.reset();
+    this->_done.reset();
+}
+
+void TableView::_run_sort(std::shared_ptr<RowProvider> rows,
+    size_t col, bool descending) {
+    size_t n = std::min<size_t>(rows->rows(), UINT32_MAX);
+
+    // every cell is read once, not on every comparison
+    std::vector<SortKey> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (i % 1024 == 0 && this->_cancel)
+            return;
+        SortKey& k = keys[i];
+        rows->cell(i, col, k.text);
+
+        char* end;
+        k.num    = strtod(k.text.c_str(), &end);
+        k.is_num = !k.text.empty() && *end == '\0';
+    }
+
+    Sort sort{col, descending, std::vector<u32>(n)};
+    std::iota(sort.order.begin(), sort.order.end(), 0);
+    auto less = [&](u32 a, u32 b) {
+        if (this->_cancel.load(std::memory_order_relaxed))
+            throw SortCancelled{};
+        return descending ? _less(keys[b], keys[a])
+                          : _less(keys[a], keys[b]);
+    };
+    try {
+        std::stable_sort(
+            sort.order.begin(), sort.order.end(), less);
+    }
+    catch (const SortCancelled&) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(this->_lock);
+    this->_done    = std::move(sort);
+    this->_sorting = false;
+}
+
+void TableView::_take_sort() const {
+    std::lock_guard<std::mutex> guard(this->_lock);
+    if (this->_done) {
+        this->_sort = std::move(this->_done);
+        this->_done.reset();
+    }
+}
+
+size_t TableView::row_at(size_t index) const {
+    // rows added after the sort stay at the end
+    if (this->_sort && index < this->_sort->order.size())
+        return this->_sort->order[index];
+    return index;
+}
+
+// ----------[rendering]----------
+void TableView::_grow(
+    size_t col, const std::string& text) const {
+    size_t w = std::min(glyph_count(text), this->max_width);
+    if (w > this->_widths[col])
+        this->_widths[col] = w;
+}
+
+void TableView::render(Buffer& buffer) const {
+    size_t w = buffer.width(), h = buffer.height();
+    if (w == 0 || h == 0 || !this->_rows)
+        return;
+
+    this->_take_sort();
+    const RowProvider& rows = *this->_rows;
+    size_t n = rows.rows(), cols = rows.columns();
+    // rows went away, the order points past them
+    if (this->_sort && this->_sort->order.size() > n)
+        this->_sort.reset();
+    if (this->_widths.size() != cols)
+        this->_widths.assign(cols, 0);
+
+    // a few more rows for the widths every render, new rows
+    // are measured as they come in
+    size_t end = std::min(n, this->_sampled + SAMPLE);
+    for (; this->_sampled < end; ++this->_sampled) {
+        for (size_t c = 0; c < cols; ++c) {
+            rows.cell(this->_sampled, c, this->_text);
+            this->_grow(c, this->_text);
+        }
+    }
+
+    // lines are the rows, when the header isn't sticky it
+    // is the first one
+    bool sticky  = this->sticky_header;
+    size_t lines = n + !sticky;
+    this->_page  = h - sticky;
+    if (this->_offset + this->_page > lines)
+        this->_offset =
+            lines > this->_page ? lines - this->_page : 0;
+
+    // everything visible is read before drawing so the
+    // widths are final
+    bool header  = sticky || this->_offset == 0;
+    size_t first = this->_offset;
+    if (!sticky && first > 0)
+        first--;
+    size_t count = 0;
+    if (first < n)
+        count = std::min(n - first, h - header);
+    this->_cells.resize(std::max(this->_cells.size(),
+        (count + 1) * cols));
+
+    for (size_t c = 0; c < cols && header; ++c) {
+        std::string& text = this->_cells[c];
+        rows.header(c, text);
+        if (this->_sort && this->_sort->col == c)
+            text += this->_sort->descending ? " ▼"
+                                            : " ▲";
+        this->_grow(c, text);
+    }
+    for (size_t y = 0; y < count; ++y) {
+        size_t row = this->row_at(first + y);
+        for (size_t c = 0; c < cols; ++c) {
+            auto& text = this->_cells[(y + 1) * cols + c];
+            rows.cell(row, c, text);
+            this->_grow(c, text);
+        }
+    }
+
+    TextLayout layout;
+    layout.truncate = true;
+    layout.ellipsis = "…";
+    layout.color    = this->color;
+
+    // line i of the cells at screen row y
+    auto put_row = [&](size_t y, size_t i) {
+        size_t x = 0;
+        for (size_t c = 0; c < cols && x < w; ++c) {
+            size_t cw = std::min(this->_widths[c], w - x);
+            buffer.get_sub_buffer(x, y, cw, 1)
+                .write(this->_cells[i * cols + c], layout);
+            // one space between columns
+            x += this->_widths[c] + 1;
+        }
+    };
+
+    if (header) {
+        put_row(0, 0);
+        for (size_t x = 0; x < w; ++x)
+            buffer.get(x, 0).attr |= attr::BOLD;
+    }
+    for (size_t y = 0; y < count; ++y) {
+        size_t sy = y + header;
+        put_row(sy, y + 1);
+        if (this->selected == first + y) {
+            for (size_t x = 0; x < w; ++x)
+                buffer.get(x, sy).attr |= attr::REVERSE;
+        }
+    }
+}
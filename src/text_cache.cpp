@@ -0,0 +1,147 @@
+#include <ly/render/text_cache.hpp>
+
+#include <algorithm>
+#include <functional>
+
+using namespace ly;
+using namespace ly::render;
+
+static u64 _mix(u64 h, u64 v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) +
+                   (h >> 2));
+}
+
+static u64 _hash(std::string_view text, size_t w, size_t h,
+    const TextLayout& layout) {
+    u64 hash = std::hash<std::string_view>{}(text);
+    hash     = _mix(hash, w);
+    hash     = _mix(hash, h);
+    hash     = _mix(hash, (u64)layout.align << 1 |
+                              layout.truncate);
+    if (!layout.ellipsis.empty())
+        hash = _mix(hash,
+            std::hash<std::string_view>{}(layout.ellipsis));
+    return hash;
+}
+
+TextCache::TextCache()
+    : _entries(CAPACITY), _index(CAPACITY * 2, NONE) {}
+
+bool TextCache::_matches(const Entry& e, u64 hash,
+    size_t w, size_t h, std::string_view text,
+    const TextLayout& layout) const {
+    return e.hash == hash && e.run.width == w &&
+           e.height == h && e.align == layout.align &&
+           e.truncate == layout.truncate &&
+           e.text == text && e.ellipsis == layout.ellipsis;
+}
+
+void TextCache::_unlink(u32 i) {
+    Entry& e = this->_entries[i];
+    if (e.prev != NONE)
+        this->_entries[e.prev].next = e.next;
+    else
+        this->_first = e.next;
+    if (e.next != NONE)
+        this->_entries[e.next].prev = e.prev;
+    else
+        this->_last = e.prev;
+    e.prev = e.next = NONE;
+}
+
+void TextCache::_push_front(u32 i) {
+    Entry& e = this->_entries[i];
+    e.prev   = NONE;
+    e.next   = this->_first;
+    if (this->_first != NONE)
+        this->_entries[this->_first].prev = i;
+    this->_first = i;
+    if (this->_last == NONE)
+        this->_last = i;
+}
+
+// the entries after the hole that can't be reached from
+// their slot anymore move back into it
+void TextCache::_erase_index(u64 hash, u32 i) {
+    size_t mask = this->_index.size() - 1;
+    size_t hole = hash & mask;
+    while (this->_index[hole] != i)
+        hole = (hole + 1) & mask;
+    this->_index[hole] = NONE;
+
+    size_t at = hole;
+    while (true) {
+        at = (at + 1) & mask;
+        u32 j = this->_index[at];
+        if (j == NONE)
+            break;
+        size_t home = this->_entries[j].hash & mask;
+        // home is in (hole, at], j is still reachable
+        bool stays = hole <= at
+                         ? hole < home && home <= at
+                         : hole < home || home <= at;
+        if (stays)
+            continue;
+        this->_index[hole] = j;
+        this->_index[at]   = NONE;
+        hole               = at;
+    }
+}
+
+const TextRun& TextCache::get(const Buffer& buf,
+    std::string_view text, const TextLayout& layout) {
+    size_t w    = buf.width();
+    size_t h    = buf.height();
+    u64 hash    = _hash(text, w, h, layout);
+    size_t mask = this->_index.size() - 1;
+
+    size_t at = hash & mask;
+    for (; this->_index[at] != NONE; at = (at + 1) & mask) {
+        u32 i = this->_index[at];
+        if (!this->_matches(this->_entries[i], hash, w, h,
+                text, layout))
+            continue;
+        this->_hits++;
+        if (this->_first != i) {
+            this->_unlink(i);
+            this->_push_front(i);
+        }
+        return this->_entries[i].run;
+    }
+    this->_misses++;
+
+    // a new entry, or the one used the longest time ago
+    u32 i;
+    if (this->_size < CAPACITY) {
+        i = this->_size++;
+    }
+    else {
+        i = this->_last;
+        this->_unlink(i);
+        this->_erase_index(this->_entries[i].hash, i);
+        // the hole may have been before at
+        at = hash & mask;
+        while (this->_index[at] != NONE)
+            at = (at + 1) & mask;
+    }
+
+    Entry& e   = this->_entries[i];
+    e.hash     = hash;
+    e.height   = h;
+    e.align    = layout.align;
+    e.truncate = layout.truncate;
+    e.text.assign(text);
+    e.ellipsis.assign(layout.ellipsis);
+    buf.layout(text, layout, e.run);
+
+    this->_index[at] = i;
+    this->_push_front(i);
+    return e.run;
+}
+
+void TextCache::clear() {
+    std::fill(
+        this->_index.begin(), this->_index.end(), NONE);
+    this->_size  = 0;
+    this->_first = this->_last = NONE;
+}
@@ -1,4 +1,5 @@
 #include <ly/render/utils.hpp>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <termios.h>
@@ -30,18 +31,39 @@ void render::set_raw_mode() {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
 }
 
-void render::reset_cursor() {
-    printf("\e[0;0H"); // return cursor to 0,0
-    fflush(stdout);
+static volatile sig_atomic_t resized = 0;
+
+static void on_winch(int) {
+    resized = 1;
+}
+
+void render::watch_resize() {
+    struct sigaction sa = {};
+    sa.sa_handler       = on_winch;
+    sa.sa_flags         = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGWINCH, &sa, nullptr);
+}
+
+bool render::take_resize() {
+    if (!resized)
+        return false;
+    resized = 0;
+    return true;
+}
+
+void render::reset_cursor(TerminalSink& sink) {
+    sink.write("\e[0;0H"); // return cursor to 0,0
+    sink.flush();
 }
-void render::enter_alternate_screen() {
-    printf("\e[?1049h"); // enter alternate screen
-    printf("\e[0;0H");   // move cursor to 0
-    printf("\e[?25l");   // hide cursor
-    fflush(stdout);
+void render::enter_alternate_screen(TerminalSink& sink) {
+    sink.write("\e[?1049h"); // enter alternate screen
+    sink.write("\e[0;0H");   // move cursor to 0
+    sink.write("\e[?25l");   // hide cursor
+    sink.flush();
 }
-void render::leave_alternate_screen() {
-    printf("\e[?1049l"); // leave alternate screen
-    printf("\e[?25h");   // show cursor
-    fflush(stdout);
+void render::leave_alternate_screen(TerminalSink& sink) {
+    sink.write("\e[?1049l"); // leave alternate screen
+    sink.write("\e[?25h");   // show cursor
+    sink.flush();
 }
@@ -0,0 +1,304 @@
+#include <charconv>
+#include <cstdio>
+#include <vector>
+
+#include <ly/render/vscreen.hpp>
+
+using namespace ly;
+using namespace ly::render;
+
+static size_t _utf8_len(unsigned char c) {
+    if ((c & 0b10000000) == 0)
+        return 1;
+    if ((c & 0b11100000) == 0b11000000)
+        return 2;
+    if ((c & 0b11110000) == 0b11100000)
+        return 3;
+    if ((c & 0b11111000) == 0b11110000)
+        return 4;
+    return 1;
+}
+
+// numbers separated by ';', empty ones are def
+static std::vector<size_t> _params(
+    std::string_view s, size_t def) {
+    std::vector<size_t> out;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(';', start);
+        if (end == std::string_view::npos)
+            end = s.size();
+
+        size_t val = def;
+        if (end > start)
+            std::from_chars(s.data() + start, s.data() + end, val);
+        out.push_back(val);
+        start = end + 1;
+    }
+    return out;
+}
+
+VirtualScreen::VirtualScreen(size_t w, size_t h)
+    : _w(w), _h(h), _cells(w * h), _bottom(h - 1) {}
+
+// moves the scroll region up n rows (down if negative),
+// the rows it exposes are blank with the pen background
+void VirtualScreen::_scroll(long n) {
+    size_t d = n > 0 ? n : -n;
+    for (size_t i = 0; i <= this->_bottom - this->_top; ++i) {
+        size_t y   = n > 0 ? this->_top + i : this->_bottom - i;
+        size_t src = n > 0 ? y + d : y - d;
+        bool inside =
+            n > 0 ? src <= this->_bottom
+                  : y >= this->_top + d;
+        for (size_t x = 0; x < this->_w; ++x) {
+            if (inside)
+                this->_at(x, y) = this->_at(x, src);
+            else
+                this->_at(x, y) = {" ", this->_fc, this->_bc, 0};
+        }
+    }
+}
+
+void VirtualScreen::_print(std::string_view glyph) {
+    if (this->_wrap) {
+        this->_wrap = false;
+        this->_cx   = 0;
+        if (this->_cy + 1 < this->_h)
+            this->_cy++;
+    }
+
+    auto& c = this->_at(this->_cx, this->_cy);
+    c.glyph = glyph;
+    c.fc    = this->_fc;
+    c.bc    = this->_bc;
+    c.attr  = this->_attr;
+    this->_last = glyph;
+
+    if (this->_cx + 1 < this->_w)
+        this->_cx++;
+    else
+        this->_wrap = true;
+}
+
+void VirtualScreen::_sgr(std::string_view params) {
+    auto p = _params(params, 0);
+    for (size_t i = 0; i < p.size(); ++i) {
+        size_t v = p[i];
+        if (v == 0) {
+            this->_fc   = DEFAULT;
+            this->_bc   = DEFAULT;
+            this->_attr = 0;
+        }
+        else if (v == 1)
+            this->_attr |= attr::BOLD;
+        else if (v == 2)
+            this->_attr |= attr::DIM;
+        else if (v == 3)
+            this->_attr |= attr::ITALIC;
+        else if (v == 4)
+            this->_attr |= attr::UNDERLINE;
+        else if (v == 7)
+            this->_attr |= attr::REVERSE;
+        else if (v == 9)
+            this->_attr |= attr::STRIKE;
+        else if (v == 22)
+            this->_attr &= ~(attr::BOLD | attr::DIM);
+        else if (v == 23)
+            this->_attr &= ~attr::ITALIC;
+        else if (v == 24)
+            this->_attr &= ~attr::UNDERLINE;
+        else if (v == 27)
+            this->_attr &= ~attr::REVERSE;
+        else if (v == 29)
+            this->_attr &= ~attr::STRIKE;
+        else if (v >= 30 && v <= 37) {
+            this->_fc = ConsoleColor(v - 30).pack();
+        }
+        else if (v >= 40 && v <= 47) {
+            this->_bc = ConsoleColor(v - 40).pack();
+        }
+        else if (v >= 90 && v <= 97) {
+            this->_fc = ConsoleColor::indexed(v - 82).pack();
+        }
+        else if (v >= 100 && v <= 107) {
+            this->_bc = ConsoleColor::indexed(v - 92).pack();
+        }
+        else if ((v == 38 || v == 48) && i + 2 < p.size() &&
+                 p[i + 1] == 5) {
+            // same as what downsample gives
+            u32 col = ConsoleColor::indexed(p[i + 2])
+                          .downsample(ColorDepth::Indexed256)
+                          .pack();
+            (v == 38 ? this->_fc : this->_bc) = col;
+            i += 2;
+        }
+        else if ((v == 38 || v == 48) && i + 4 < p.size() &&
+                 p[i + 1] == 2) {
+            u32 col = ConsoleColor(Color<u8>{(u8)p[i + 2],
+                (u8)p[i + 3], (u8)p[i + 4]})
+                          .pack();
+            (v == 38 ? this->_fc : this->_bc) = col;
+            i += 4;
+        }
+    }
+}
+
+void VirtualScreen::_csi(std::string_view params, char final) {
+    // private modes don't change the contents
+    if (!params.empty() && params[0] == '?')
+        return;
+
+    auto p   = _params(params, 1);
+    size_t n = p[0] ? p[0] : 1;
+    switch (final) {
+    case 'H':
+        this->_cy = std::min(p[0] ? p[0] - 1 : 0, this->_h - 1);
+        this->_cx = std::min(
+            p.size() > 1 && p[1] ? p[1] - 1 : 0, this->_w - 1);
+        this->_wrap = false;
+        return;
+    case 'A':
+        this->_cy = this->_cy > n ? this->_cy - n : 0;
+        break;
+    case 'B':
+        this->_cy = std::min(this->_cy + n, this->_h - 1);
+        break;
+    case 'C':
+        this->_cx = std::min(this->_cx + n, this->_w - 1);
+        break;
+    case 'D':
+        this->_cx = this->_cx > n ? this->_cx - n : 0;
+        break;
+    case 'X':
+        for (size_t x = this->_cx;
+            x < std::min(this->_cx + n, this->_w); ++x) {
+            this->_at(x, this->_cy) = {" ", this->_fc, this->_bc, 0};
+        }
+        break;
+    case 'K':
+        for (size_t x = this->_cx; x < this->_w; ++x)
+            this->_at(x, this->_cy) = {" ", this->_fc, this->_bc, 0};
+        break;
+    case 'r': {
+        size_t top = p[0] ? p[0] - 1 : 0;
+        size_t bot = p.size() > 1 && p[1] ? p[1] - 1
+                                          : this->_h - 1;
+        if (top < bot && bot < this->_h) {
+            this->_top    = top;
+            this->_bottom = bot;
+        }
+        this->_cx   = 0;
+        this->_cy   = 0;
+        this->_wrap = false;
+        return;
+    }
+    case 'S':
+        this->_scroll((long)n);
+        return;
+    case 'T':
+        this->_scroll(-(long)n);
+        return;
+    case 'b':
+        for (size_t i = 0; i < n; ++i) {
+            std::string last = this->_last;
+            this->_print(last);
+        }
+        return;
+    case 'm':
+        this->_sgr(params);
+        return;
+    default:
+        return;
+    }
+    this->_wrap = false;
+}
+
+void VirtualScreen::feed(std::string_view data) {
+    std::string joined;
+    if (!this->_pending.empty()) {
+        joined = this->_pending;
+        joined += data;
+        data   = joined;
+        this->_pending.clear();
+    }
+
+    size_t i = 0;
+    while (i < data.size()) {
+        unsigned char c = data[i];
+        if (c == '\e') {
+            if (i + 1 >= data.size())
+                break;
+            if (data[i + 1] != '[') {
+                i += 2;
+                continue;
+            }
+            size_t j = i + 2;
+            while (j < data.size() &&
+                   !(data[j] >= 0x40 && data[j] <= 0x7e))
+                j++;
+            if (j >= data.size())
+                break;
+            this->_csi(data.substr(i + 2, j - i - 2), data[j]);
+            i = j + 1;
+        }
+        else if (c == '\r') {
+            this->_cx   = 0;
+            this->_wrap = false;
+            i++;
+        }
+        else if (c == '\n') {
+            if (this->_cy + 1 < this->_h)
+                this->_cy++;
+            this->_wrap = false;
+            i++;
+        }
+        else if (c < 0x20) {
+            i++;
+        }
+        else {
+            size_t len = _utf8_len(c);
+            if (i + len > data.size())
+                break;
+            this->_print(data.substr(i, len));
+            i += len;
+        }
+    }
+
+    this->_pending = data.substr(i);
+}
+
+bool VirtualScreen::matches(const Buffer& buf,
+    std::string* why, ColorDepth depth) const {
+    for (size_t y = 0; y < this->_h && y < buf.height(); ++y) {
+        for (size_t x = 0; x < this->_w && x < buf.width();
+            ++x) {
+            const auto& v = this->get(x, y);
+            const auto& u = buf.get(x, y);
+            u32 fc        = u.fc.downsample(depth).pack();
+            u32 bc        = u.bc.downsample(depth).pack();
+
+            bool same = v.glyph == u.data && v.bc == bc;
+            if (u.data == " " && !(u.attr & attr::VISIBLE))
+                same = same && !(v.attr & attr::VISIBLE);
+            else
+                same = same && v.fc == fc && v.attr == u.attr;
+
+            if (!same) {
+                if (why) {
+                    char col[64];
+                    snprintf(col, sizeof(col),
+                        " (fc %08x bc %08x, expected %08x %08x)",
+                        v.fc, v.bc, fc, bc);
+                    *why = "cell " + std::to_string(x) + "," +
+                           std::to_string(y) + " is '" +
+                           v.glyph + "' expected '" +
+                           std::string(u.data.view()) + "'" +
+                           col;
+                }
+                return false;
+            }
+        }
+    }
+    return true;
+}
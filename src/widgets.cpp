@@ -1,4 +1,233 @@
 #include <ly/render/widgets.hpp>
 
+#include <algorithm>
+#include <cstdio>
+
 using namespace ly::render;
 using namespace ly::render::widgets;
+
+void StatsOverlay::render(Buffer& buffer) const {
+    if (!this->visible || this->_prof.size() == 0)
+        return;
+
+    const auto& f = this->_prof.get(0);
+    char line[StatsOverlay::WIDTH + 1];
+    size_t row = 0;
+
+    auto put = [&](int len) {
+        if (row >= buffer.height())
+            return;
+        auto sub = buffer.get_sub_buffer(0, row++, WIDTH, 1);
+        for (size_t x = 0; x < WIDTH; ++x) {
+            auto& u = sub.get(x, 0);
+            u.data  = " ";
+            if ((int)x < len)
+                u.data = std::string(1, line[x]);
+            u.fc = ConsoleColor::WHITE;
+            u.bc = ConsoleColor::BLUE;
+        }
+    };
+
+    put(snprintf(line, sizeof(line), "fps     %8.1f",
+        this->_prof.fps()));
+    put(snprintf(line, sizeof(line), "busy    %8.1fus",
+        f.busy_ns / 1000.));
+    for (size_t p = 0; p < PHASE_COUNT; ++p) {
+        put(snprintf(line, sizeof(line), "%-7s %8.1fus",
+            phase_name((Phase)p), f.phase_ns[p] / 1000.));
+    }
+    put(snprintf(line, sizeof(line), "cells   %8llu",
+        (unsigned long long)f.cells_changed));
+    put(snprintf(line, sizeof(line), "bytes   %8llu",
+        (unsigned long long)f.bytes_written));
+    put(snprintf(line, sizeof(line), "lua     %8llu",
+        (unsigned long long)f.lua_calls));
+    put(snprintf(line, sizeof(line), "allocs  %8llu",
+        (unsigned long long)f.allocs));
+    put(snprintf(line, sizeof(line), "lua mem %8.1fK",
+        f.mem_peak / 1024.));
+}
+
+// ----------[native widgets]----------
+void Label::render(Buffer& buffer) const {
+    TextLayout layout;
+    layout.align    = this->align;
+    layout.truncate = this->truncate;
+    layout.ellipsis = this->ellipsis;
+    layout.color    = this->color;
+    buffer.write(this->text, layout);
+}
+
+void ProgressBar::render(Buffer& buffer) const {
+    size_t x = buffer.width();
+    if (x < 2 || buffer.height() == 0)
+        return;
+
+    f64 value = std::clamp(this->value, 0., 1.);
+    if (this->show_number && x > 10) {
+        char num[8];
+        int len = snprintf(
+            num, sizeof(num), "%.0f%%", value * 100);
+        buffer.get_sub_buffer(x - 7, 0, 7, 1)
+            .write(std::string_view(num, len));
+        x -= 8;
+    }
+
+    buffer.get(0, 0).data     = "[";
+    buffer.get(x - 1, 0).data = "]";
+
+    size_t fill = (size_t)((x - 2) * value);
+    for (size_t i = 0; i < fill; ++i) {
+        auto& u = buffer.get(i + 1, 0);
+        u.data  = "|";
+        u.fc    = this->color;
+    }
+}
+
+void Gauge::render(Buffer& buffer) const {
+    size_t w = buffer.width(), h = buffer.height();
+    if (w == 0 || h == 0)
+        return;
+
+    f64 value   = std::clamp(this->value, 0., 1.);
+    size_t fill = (size_t)(w * value);
+    for (size_t y = 0; y < h; ++y)
+        for (size_t x = 0; x < fill; ++x)
+            buffer.get(x, y).bc = this->color;
+
+    char num[8];
+    std::string_view text = this->label;
+    if (text.empty()) {
+        int len = snprintf(
+            num, sizeof(num), "%.0f%%", value * 100);
+        text = std::string_view(num, len);
+    }
+
+    TextLayout layout;
+    layout.align    = Align::Center;
+    layout.truncate = true;
+    buffer.get_sub_buffer(0, h / 2, w, 1).write(text, layout);
+}
+
+void List::move(i64 delta) {
+    if (this->items.empty()) {
+        this->selected.reset();
+        return;
+    }
+
+    i64 last = this->items.size() - 1;
+    i64 to   = 0;
+    // the items may have shrunk under the selection
+    if (this->selected)
+        to = std::min((i64)*this->selected, last) + delta;
+    this->selected = std::clamp<i64>(to, 0, last);
+}
+
+void List::render(Buffer& buffer) const {
+    size_t w = buffer.width(), h = buffer.height();
+    if (w == 0 || h == 0)
+        return;
+
+    // the selected item is kept on the last row when it is
+    // past the first page, one past the end isn't shown
+    auto sel = this->selected;
+    if (sel && *sel >= this->items.size())
+        sel.reset();
+    size_t offset = 0;
+    if (sel && *sel >= h)
+        offset = *sel - h + 1;
+
+    TextLayout layout;
+    layout.truncate = true;
+    layout.ellipsis = "…";
+    layout.color    = this->color;
+    for (size_t y = 0; y < h; ++y) {
+        size_t i = offset + y;
+        if (i >= this->items.size())
+            break;
+        buffer.get_sub_buffer(0, y, w, 1)
+            .write(this->items[i], layout);
+        if (sel == i) {
+            for (size_t x = 0; x < w; ++x)
+                buffer.get(x, y).attr |= attr::REVERSE;
+        }
+    }
+}
+
+void Table::render(Buffer& buffer) const {
+    size_t w = buffer.width(), h = buffer.height();
+    if (w == 0 || h == 0)
+        return;
+
+    std::vector<size_t> widths(this->headers.size());
+    for (size_t c = 0; c < this->headers.size(); ++c)
+        widths[c] = glyph_count(this->headers[c]);
+    for (const auto& row : this->rows) {
+        if (row.size() > widths.size())
+            widths.resize(row.size());
+        for (size_t c = 0; c < row.size(); ++c)
+            widths[c] =
+                std::max(widths[c], glyph_count(row[c]));
+    }
+
+    TextLayout layout;
+    layout.truncate = true;
+    layout.ellipsis = "…";
+    layout.color    = this->color;
+
+    using Row    = std::vector<std::string>;
+    auto put_row = [&](size_t y, const Row& row) {
+        size_t x = 0;
+        for (size_t c = 0; c < row.size() && x < w; ++c) {
+            size_t cw = std::min(widths[c], w - x);
+            buffer.get_sub_buffer(x, y, cw, 1)
+                .write(row[c], layout);
+            // one space between columns
+            x += widths[c] + 1;
+        }
+    };
+
+    put_row(0, this->headers);
+    for (size_t x = 0; x < w; ++x)
+        buffer.get(x, 0).attr |= attr::BOLD;
+    for (size_t y = 1; y < h && y - 1 < this->rows.size(); ++y)
+        put_row(y, this->rows[y - 1]);
+}
+
+void Box::render(Buffer& buffer) const {
+    size_t w = buffer.width(), h = buffer.height();
+    if (w < 2 || h < 2)
+        return;
+
+    auto put = [&](size_t x, size_t y, const char* g) {
+        auto& u = buffer.get(x, y);
+        u.data  = g;
+        u.fc    = this->color;
+    };
+    for (size_t x = 1; x + 1 < w; ++x) {
+        put(x, 0, "─");
+        put(x, h - 1, "─");
+    }
+    for (size_t y = 1; y + 1 < h; ++y) {
+        put(0, y, "│");
+        put(w - 1, y, "│");
+    }
+    put(0, 0, "┌");
+    put(w - 1, 0, "┐");
+    put(0, h - 1, "└");
+    put(w - 1, h - 1, "┘");
+
+    if (!this->title.empty() && w > 4) {
+        TextLayout layout;
+        layout.truncate = true;
+        layout.ellipsis = "…";
+        layout.color    = this->color;
+        buffer.get_sub_buffer(2, 0, w - 4, 1)
+            .write(this->title, layout);
+    }
+
+    if (this->child && w > 2 && h > 2) {
+        auto inner = buffer.get_sub_buffer(1, 1, w - 2, h - 2);
+        this->child->render(inner);
+    }
+}
@@ -1,73 +1,307 @@
 #include <cstdio>
+#include <cstdlib>
 #include <print>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
 #include <ly/render/buffer.hpp>
+#include <ly/render/record.hpp>
 #include <ly/render/window.hpp>
 #include "ly/render/utils.hpp"
 
+using namespace ly;
 using namespace ly::render;
 
-Window::Window() : _front(10, 10), _back(10, 10) {}
+Window::Window()
+    : _front(10, 10), _back(10, 10), _encoder(detect_caps()) {
+    this->_attach_text();
+}
 
 Window::~Window() {}
 
-void Window::resize() {
+// from the sink, or the terminal on stdin
+bool Window::_terminal_size(size_t& width, size_t& height) {
+    if (_sink->size(width, height))
+        return width > 0 && height > 0;
+
     struct winsize w;
-    ioctl(STDIN_FILENO, TIOCGWINSZ, &w);
-    if (_height != w.ws_row || _width != w.ws_col) {
-        _front  = Buffer(w.ws_col, w.ws_row);
-        _back   = Buffer(w.ws_col, w.ws_row);
-        _width  = w.ws_col;
-        _height = w.ws_row;
-    }
+    if (ioctl(STDIN_FILENO, TIOCGWINSZ, &w) < 0 ||
+        w.ws_col == 0 || w.ws_row == 0)
+        return false;
+    width  = w.ws_col;
+    height = w.ws_row;
+    return true;
+}
+
+bool Window::resize() {
+    size_t width, height;
+    if (!_terminal_size(width, height))
+        return false;
+    return this->resize(width, height);
+}
+
+bool Window::resize(size_t width, size_t height) {
+    if (width == _width && height == _height)
+        return false;
+
+    _front.resize(width, height, default_fc, default_bc);
+    _back.resize(width, height, default_fc, default_bc);
+    _width  = width;
+    _height = height;
+    // the terminal may have moved or dropped what it showed
+    this->invalidate();
+    return true;
 }
 
 void Window::init_buffer() {
-    struct winsize w;
-    ioctl(STDIN_FILENO, TIOCGWINSZ, &w);
-    _width       = w.ws_col;
-    _height      = w.ws_row;
+    size_t width = 80, height = 24;
+    _terminal_size(width, height);
+    this->init_buffer(width, height);
+}
+
+void Window::init_buffer(size_t width, size_t height) {
+    _width       = width;
+    _height      = height;
     this->_front = Buffer(_width, _height, this->default_fc,
         this->default_bc);
     this->_back  = Buffer(_width, _height, this->default_fc,
          this->default_bc);
+    this->_attach_text();
+    this->invalidate();
 }
 
-void Window::render() {
-    ConsoleColor last_fc = this->default_fc;
-    ConsoleColor last_bc = this->default_bc;
-    last_fc.display_fc();
-    last_bc.display_bc();
+// the buffers swap their cells, both need it
+void Window::_attach_text() {
+    TextCache* cache = nullptr;
+    if (this->_use_text)
+        cache = &this->_text;
+    this->_front.set_text_cache(cache);
+    this->_back.set_text_cache(cache);
+}
 
-    reset_cursor();
-    for (size_t y = 0; y < _back.height(); ++y) {
-        for (size_t x = 0; x < _back.width(); ++x) {
-            auto& cur = _back.get(x, y);
+void Window::set_text_cache(bool on) {
+    this->_use_text = on;
+    this->_attach_text();
+}
 
-            if (cur.fc != last_fc) {
-                cur.fc.display_fc();
-                last_fc = cur.fc;
-            }
+void Window::invalidate() {
+    _full = true;
+    _encoder.invalidate();
+}
+
+static u64 _row_hash(const Buffer& buf, size_t y) {
+    // fnv-1a
+    u64 h    = 0xcbf29ce484222325;
+    auto mix = [&](const void* p, size_t n) {
+        auto b = static_cast<const unsigned char*>(p);
+        for (size_t i = 0; i < n; ++i) {
+            h ^= b[i];
+            h *= 0x100000001b3;
+        }
+    };
+    for (size_t x = 0; x < buf.width(); ++x) {
+        const auto& u = buf.get(x, y);
+        u32 col[2]    = {u.fc.pack(), u.bc.pack()};
+        mix(u.data.data(), u.data.size());
+        mix(col, sizeof(col));
+        mix(&u.attr, 1);
+    }
+    return h;
+}
+
+// looks for a block of rows of _back that are in _front
+// shifted up or down, picks the one that saves the most.
+// costs are rough guesses of the bytes sent
+std::optional<Scroll> Window::_find_scroll() {
+    // about what the scroll sequences cost
+    constexpr long MIN_SAVED = 16;
+    // moving the cursor to a run
+    constexpr long MOVE = 6;
+
+    const size_t w = _back.width();
+    const size_t h = _back.height();
+    const auto& fh = _front_hash;
+    const auto& bh = _back_hash;
+
+    size_t moved = 0;
+    for (size_t y = 0; y < h; ++y)
+        if (bh[y] != fh[y])
+            moved++;
+    if (moved < 2)
+        return std::nullopt;
+
+    // what each row costs repainted in place and sent whole,
+    // a blank tail is a single erase
+    _row_cost.assign(h, 0);
+    _row_len.assign(h, 0);
+    for (size_t y = 0; y < h; ++y) {
+        size_t len = w;
+        while (len > 0) {
+            const auto& u = _back.get(len - 1, y);
+            if (u.data != " " || (u.attr & attr::VISIBLE))
+                break;
+            len--;
+        }
+        _row_len[y] = len + MOVE;
+
+        if (bh[y] == fh[y])
+            continue;
+        bool in_run = false;
+        for (size_t x = 0; x < w; ++x) {
+            bool diff = !(_back.get(x, y) == _front.get(x, y));
+            if (diff)
+                _row_cost[y] += in_run ? 1 : 1 + MOVE;
+            in_run = diff;
+        }
+    }
 
-            if (cur.bc != last_bc) {
-                cur.bc.display_bc();
-                last_bc = cur.bc;
+    std::optional<Scroll> best;
+    long best_saved = MIN_SAVED;
+
+    for (size_t d = 1; d < h; ++d) {
+        for (long dir : {1, -1}) {
+            size_t run = 0;
+            long saved = 0;
+            for (size_t y = 0; y <= h; ++y) {
+                bool match = false;
+                if (y < h && (dir > 0 ? y + d < h : y >= d))
+                    match = bh[y] == fh[dir > 0 ? y + d : y - d];
+                if (match) {
+                    run++;
+                    saved += _row_cost[y];
+                    continue;
+                }
+
+                if (run > 0) {
+                    // rows [a, b] of _back come from _front
+                    size_t a = y - run, b = y - 1;
+                    Scroll sc = dir > 0
+                                    ? Scroll{a, b + d, (long)d}
+                                    : Scroll{a - d, b, -(long)d};
+
+                    // the exposed rows are repainted whole
+                    size_t ex = dir > 0 ? b + 1 : a - d;
+                    for (size_t e = ex; e < ex + d; ++e)
+                        saved -= (long)_row_len[e] -
+                                 (long)_row_cost[e];
+
+                    if (saved > best_saved) {
+                        best_saved = saved;
+                        best       = sc;
+                    }
+                }
+                run   = 0;
+                saved = 0;
             }
+        }
+    }
+    return best;
+}
+
+// collects the runs of cells that changed since the last
+// frame, then _back becomes _front
+size_t Window::_diff() {
+    size_t changed = 0;
+    _damage.clear();
+    _scroll.reset();
+
+    _back_hash.resize(_back.height());
+    for (size_t y = 0; y < _back.height(); ++y)
+        _back_hash[y] = _row_hash(_back, y);
+
+    if (_full) {
+        _full = false;
+        for (size_t y = 0; y < _back.height(); ++y)
+            _damage.push_back({0, y, _back.width()});
+        _front.swap(_back);
+        std::swap(_front_hash, _back_hash);
+        return _front.width() * _front.height();
+    }
+
+    // rows pushed in by the scroll are sent whole
+    size_t exposed = 0, exposed_end = 0;
+    if (_encoder.caps().scroll)
+        _scroll = _find_scroll();
+    if (_scroll) {
+        size_t n = std::abs(_scroll->n);
+        _front.shift_rows(_scroll->top, _scroll->bottom,
+            _scroll->n);
+        exposed     = _scroll->n > 0 ? _scroll->bottom + 1 - n
+                                     : _scroll->top;
+        exposed_end = exposed + n;
+    }
+
+    for (size_t y = 0; y < _back.height(); ++y) {
+        if (y >= exposed && y < exposed_end) {
+            _damage.push_back({0, y, _back.width()});
+            changed += _back.width();
+            continue;
+        }
 
-            // this is a bottleneck according to perf lol
-            // maybe I should just create a long strign and
-            // print that idk
-            printf("%s", cur.data.c_str());
+        size_t start = SIZE_MAX;
+        const Unit* cur  = &_back.get(0, y);
+        const Unit* prev = &_front.get(0, y);
+        for (size_t x = 0; x < _back.width(); ++x) {
+            if (cur[x] == prev[x]) {
+                if (start != SIZE_MAX) {
+                    _damage.push_back({start, y, x - start});
+                    start = SIZE_MAX;
+                }
+                continue;
+            }
 
-            cur.fc.display_fc();
-            cur.bc.display_bc();
-            cur.fc   = this->default_fc;
-            cur.bc   = this->default_bc;
-            cur.data = " ";
+            changed++;
+            if (start == SIZE_MAX)
+                start = x;
         }
+        if (start != SIZE_MAX)
+            _damage.push_back(
+                {start, y, _back.width() - start});
+    }
+    _front.swap(_back);
+    std::swap(_front_hash, _back_hash);
+    return changed;
+}
+
+void Window::_encode() {
+    _out.clear();
+    _encoder.encode(
+        _front, _damage, _out, _scroll ? &*_scroll : nullptr);
+    // what was the front is the next frame
+    _back.clear(this->default_fc, this->default_bc);
+}
+
+void Window::_write() {
+    _sink->write(_out);
+    _sink->flush();
+}
+
+void Window::render() {
+    size_t changed = 0;
+    {
+        Profiler::Scope _t(_prof, Phase::Diff);
+        changed = _diff();
+    }
+    if (_rec)
+        _rec->record(_damage, _front, _scroll);
+    {
+        Profiler::Scope _t(_prof, Phase::Encode);
+        _encode();
+    }
+    {
+        Profiler::Scope _t(_prof, Phase::Write);
+        _write();
+    }
+
+    if (_prof) {
+        auto& f = _prof->current();
+        f.cells_changed += changed;
+        f.bytes_written += _out.size();
+        f.text_hits += _text.hits() - _text_hits;
+        f.text_misses += _text.misses() - _text_misses;
     }
+    _text_hits   = _text.hits();
+    _text_misses = _text.misses();
 }
 
 Buffer Window::get_subbuf(
@@ -0,0 +1,139 @@
+// pushes a recording made with FrameRecorder through the
+// window encoder as fast as possible (or at the recorded
+// pace with --realtime) and prints the timings as json
+//
+// usage: replay <file> [--out path] [--loops N] [--realtime]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <ly/exceptions.hpp>
+#include <ly/int.hpp>
+#include <ly/render/buffer.hpp>
+#include <ly/render/profiler.hpp>
+#include <ly/render/record.hpp>
+#include <ly/render/sink.hpp>
+#include <ly/render/window.hpp>
+
+using namespace ly;
+using namespace ly::render;
+
+static int _usage(const char* name) {
+    fprintf(stderr,
+        "usage: %s <file> [--out path] [--loops N] "
+        "[--realtime]\n",
+        name);
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    const char* file = nullptr;
+    const char* out  = nullptr;
+    size_t loops     = 1;
+    bool realtime    = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            out = argv[++i];
+        else if (!strcmp(argv[i], "--loops") && i + 1 < argc)
+            loops = strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--realtime"))
+            realtime = true;
+        else if (!file && argv[i][0] != '-')
+            file = argv[i];
+        else
+            return _usage(argv[0]);
+    }
+    if (!file)
+        return _usage(argv[0]);
+
+    std::unique_ptr<Recording> loaded;
+    try {
+        loaded = std::make_unique<Recording>(file);
+    } catch (const RuntimeError& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    Recording& rec = *loaded;
+    MemorySink mem;
+    std::unique_ptr<FileSink> fd;
+    if (out)
+        fd = std::make_unique<FileSink>(std::string(out));
+
+    Profiler prof;
+    Window win;
+    win.set_profiler(&prof);
+    win.set_sink(fd ? (TerminalSink&)*fd : mem);
+
+    // the window clears its back buffer every frame, so the
+    // damage is applied here and the full frame copied over
+    Buffer screen(1, 1);
+    size_t w = 0, h = 0;
+
+    u64 frames = 0, cells = 0;
+    u64 phases[PHASE_COUNT] = {};
+    u64 bytes = win.sink().bytes_written();
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t l = 0; l < loops; ++l) {
+        rec.rewind();
+        Recording::Frame frame;
+        auto loop_start = std::chrono::steady_clock::now();
+
+        while (rec.next(frame)) {
+            if (frame.width != w || frame.height != h) {
+                w      = frame.width;
+                h      = frame.height;
+                screen = Buffer(w, h, win.default_fc,
+                    win.default_bc);
+                win.init_buffer(w, h);
+            }
+            frame.apply(screen);
+
+            if (realtime) {
+                std::this_thread::sleep_until(loop_start +
+                    std::chrono::nanoseconds(frame.time_ns));
+            }
+
+            prof.begin_frame();
+            auto& back = win.get_buf();
+            for (size_t y = 0; y < h; ++y)
+                for (size_t x = 0; x < w; ++x)
+                    back.get(x, y) = screen.get(x, y);
+            win.render();
+            prof.end_frame();
+            mem.clear();
+
+            const auto& st = prof.get(0);
+            for (size_t p = 0; p < PHASE_COUNT; ++p)
+                phases[p] += st.phase_ns[p];
+            cells += st.cells_changed;
+            frames++;
+        }
+    }
+
+    auto elapsed =
+        Profiler::ns(std::chrono::steady_clock::now() - start);
+    bytes = win.sink().bytes_written() - bytes;
+    if (frames == 0) {
+        fprintf(stderr, "%s has no frames\n", file);
+        return 1;
+    }
+
+    printf("{\"file\": \"%s\", \"frames\": %llu, "
+           "\"ns_per_frame\": %.1f, ",
+        file, (unsigned long long)frames,
+        (f64)elapsed / frames);
+    for (size_t p = (size_t)Phase::Diff; p < PHASE_COUNT; ++p)
+        printf("\"%s_ns_per_frame\": %.1f, ",
+            phase_name((Phase)p), (f64)phases[p] / frames);
+    printf("\"cells_changed_per_frame\": %.1f, "
+           "\"bytes_per_frame\": %.1f}\n",
+        (f64)cells / frames, (f64)bytes / frames);
+    return 0;
+}